@@ -0,0 +1,1110 @@
+//
+//  sc.hurst.calc.cpp
+//  max-external
+//
+//  Hurst exponent calculation shared by the sc.hurst external and the sc.hurst.cli tool.
+//
+
+#include "sc.hurst.calc.h"
+#include <stdlib.h>                         // for malloc and free
+#include <math.h>                           // for log calculations
+
+/*==================================================================================
+ ========================CALCULATION FUNCTIONS=========================================
+ ====================================================================================*/
+
+t_hurst_calc* sc_hurst_calc_new(void* owner, double* src_data, long length, long max_blocks, double* qlist, long qlist_count, t_hurst_history* history, long estimator) {
+    t_hurst_calc* calc = (t_hurst_calc*)malloc(sizeof(t_hurst_calc));
+    
+    //object_post((t_object*)x, "Beginning Calculations");
+    
+    //history blocks only line up with the window's if both use the pyramid's block sizes
+    long div_size = (history != NULL) ? history->base_size : sc_hurst_helper_div_size(length);
+    
+    //object_post((t_object*)x, "Base division size: %ld", div_size);
+    
+    long layer_count = 0;
+    if(estimator == SC_HURST_WAVELET) {
+        //one layer per octave that still has 4 detail coefficients to average
+        for(int i = 1; (length >> i) >= 4; i++) {
+            layer_count++;
+        }
+        history = NULL; //the history only carries R/S totals
+    } else if(estimator == SC_HURST_SPECTRAL) {
+        //one layer per low frequency bin, sqrt of the span of them
+        div_size = sc_hurst_helper_spectral_size(length);
+        layer_count = (long)pow((double)div_size, 0.5);
+        history = NULL;
+        qlist_count = 0; //the periodogram has no moments to generalise over
+    } else {
+        for(int i = 0; pow(2, i) * div_size <= length ; i++) {
+            //long test_val = pow(2, i) * div_size;
+            //object_post((t_object *)x, "Current step: %ld", test_val);
+            layer_count++;
+        }
+    }
+    
+   //object_post((t_object*)x, "Layer count: %ld", layer_count);
+    
+    //block sizes too large for the window can still be averaged from the history alone
+    calc->window_layers = layer_count;
+    calc->has_history = (history != NULL);
+    if(history != NULL) {
+        calc->history = *history;
+        if(history->level_count > layer_count) {
+            layer_count = history->level_count;
+        }
+    }
+    
+    calc->owner = owner;
+    calc->src_data = src_data;
+    calc->length = length;
+    calc->max_blocks = max_blocks;
+    calc->estimator = estimator;
+    calc->div_size = div_size;
+    calc->layer_count = layer_count;
+    calc->layer = 0;
+    calc->block = 0;
+    calc->rs_sum = 0;
+    calc->rs_sqsum = 0;
+    calc->blocks_evaluated = 0;
+    calc->rs_avg = (double*)malloc(sizeof(double) * layer_count);
+    calc->size = (double*)malloc(sizeof(double) * layer_count);
+    calc->rs_var = (double*)malloc(sizeof(double) * layer_count);
+    
+    calc->q_count = qlist_count;
+    for(int m = 0; m < qlist_count; m++) {
+        calc->q[m] = qlist[m];
+        calc->q_half[m] = (qlist[m] != 0) ? qlist[m] / 2 : 0;
+        calc->q_sum[m] = 0;
+    }
+    calc->log_fluct_sum = 0;
+    calc->fq = (qlist_count > 0) ? (double*)malloc(sizeof(double) * layer_count * qlist_count) : NULL;
+    
+    return calc;
+}
+
+long sc_hurst_calc_step(t_hurst_calc* calc, double deadline, double (*clock_ms)(void)) {
+    long div_size = calc->div_size;
+    long work = 0; //samples covered since the clock was last checked
+    
+    //the wavelet pass is O(n) and the spectral one O(n log n) in a single FFT, neither is worth yielding in
+    if(calc->estimator == SC_HURST_WAVELET) {
+        if(calc->layer < calc->layer_count) {
+            sc_hurst_wavelet_pass(calc);
+        }
+        return 1;
+    }
+    if(calc->estimator == SC_HURST_SPECTRAL) {
+        if(calc->layer < calc->layer_count) {
+            sc_hurst_spectral_pass(calc);
+        }
+        return 1;
+    }
+    
+    for(; calc->layer < calc->layer_count; calc->layer++) {
+        long i = calc->layer;
+        long cur_div_size = pow(2, i) * div_size;
+        
+        long layer_size = calc->length / cur_div_size;
+        
+        //when a budget is given only a stratified subset of the layer's blocks is evaluated
+        long eval_count = (calc->max_blocks > 0 && layer_size > calc->max_blocks) ? calc->max_blocks : layer_size;
+        
+        //object_post((t_object*)x, "Layer Block Count: %ld", layer_size);
+        //object_post((t_object*)x, "Layer Div Size: %ld", cur_div_size);
+        for(; calc->block < eval_count; calc->block++) {
+            //yield once the slice's time budget is spent, checking the clock only every few thousand samples
+            if(deadline > 0 && clock_ms != NULL && work >= 4096) {
+                if(clock_ms() >= deadline) {
+                    return 0;
+                }
+                work = 0;
+            }
+            work += cur_div_size;
+            
+            long j = sc_hurst_helper_block_index(calc->block, eval_count, layer_size);
+            
+            //create and fill helper struct pointer
+            t_hurst_helper_ms* ms_temp = (t_hurst_helper_ms*)malloc(sizeof(t_hurst_helper_ms));
+            ms_temp->src_data = calc->src_data;
+            ms_temp->idx0 = (j * (pow(2, i) * div_size));
+            long end_idx = ((j + 1) * (pow(2, i) * div_size));
+            ms_temp->idx1 = (end_idx < calc->length) ? end_idx : (calc->length - 1);
+            ms_temp->mean = 0; //filled in function
+            ms_temp->stddev = 0; //filled in function
+            
+            sc_hurst_stddev_and_mean_helper(&ms_temp, calc->owner); //compute mean and standard deviation for the block.
+            
+            //copy out standard deviation and mean
+            double stddev = (ms_temp->stddev > 0) ? ms_temp->stddev : 0.0001;
+            double mean = ms_temp->mean;
+            //free the helper pointer after removing the reference to the struct data
+            ms_temp->src_data = NULL;
+            free(ms_temp);
+
+#ifdef DEBUG
+            sc_hurst_debug_post(calc->owner, "div size: %ld, block: %ld, mean: %f, stddev: %f", cur_div_size, j, mean, stddev);
+#endif
+            
+            t_hurst_helper_rs* rsa_temp = (t_hurst_helper_rs*)malloc(sizeof(t_hurst_helper_rs));
+            rsa_temp->src_data = calc->src_data;
+            rsa_temp->mean = mean;
+            rsa_temp->idx0 = (j * (pow(2, i) * div_size));
+            rsa_temp->idx1 = (end_idx < calc->length) ? end_idx : (calc->length - 1);
+            rsa_temp->detrend = (calc->q_count > 0);
+            rsa_temp->range = 0;
+            rsa_temp->fluct = 0;
+            
+            sc_hurst_helper_range(&rsa_temp);
+            double range = rsa_temp->range;
+            double rs = range / stddev;
+            calc->rs_sum += rs;
+            calc->rs_sqsum += rs * rs;
+            
+            //every moment comes from the same F^2, so K moments cost K exps per block rather than K passes
+            if(calc->q_count > 0) {
+                double log_fluct = log((rsa_temp->fluct > 0.00000001) ? rsa_temp->fluct : 0.00000001);
+                calc->log_fluct_sum += log_fluct;
+                for(int m = 0; m < calc->q_count; m++) {
+                    calc->q_sum[m] += exp(calc->q_half[m] * log_fluct);
+                }
+            }
+            
+#ifdef DEBUG
+            sc_hurst_debug_post(calc->owner, "range: %f, rs: %f", range, rs);
+#endif
+            
+            //free the struct pointer
+            rsa_temp->src_data = NULL;
+            free(rsa_temp);
+        }
+        
+        calc->blocks_evaluated += eval_count;
+        
+        //blocks that have left the window count alongside the ones still in it
+        double rs_total = calc->rs_sum;
+        double count_total = eval_count;
+        if(calc->has_history && i < calc->history.level_count) {
+            rs_total += calc->history.rs_sum[i];
+            count_total += calc->history.weight[i];
+        }
+        
+        double rs_mean = rs_total / ((count_total > 0) ? count_total : 1);
+        
+        calc->rs_avg[i] = log2(rs_mean);
+
+        calc->size[i] = log2((pow(2, i) * div_size));
+        
+        //variance of the sampled mean (with finite population correction), carried into log2 space
+        calc->rs_var[i] = 0;
+        if(eval_count < layer_size && eval_count > 1 && rs_mean > 0) {
+            double window_mean = calc->rs_sum / eval_count;
+            double sample_var = (calc->rs_sqsum - (eval_count * window_mean * window_mean)) / (eval_count - 1);
+            double share = eval_count / count_total; //history totals are exact, only the window's share of the mean was sampled
+            double mean_var = (sample_var / eval_count) * (1 - ((double)eval_count / layer_size)) * share * share;
+            calc->rs_var[i] = (mean_var > 0) ? mean_var / pow(rs_mean * log(2), 2) : 0;
+        }
+
+        
+#ifdef DEBUG
+        sc_hurst_debug_post(calc->owner, "log2rs: %f, log2size: %f", calc->rs_avg[i], calc->size[i]);
+#endif
+        //q-th order fluctuation function, F_q = (mean (F^2)^(q/2))^(1/q), or exp(mean ln(F^2) / 2) for q = 0
+        for(int m = 0; m < calc->q_count && eval_count > 0; m++) {
+            double fq = (calc->q[m] != 0) ? pow(calc->q_sum[m] / eval_count, 1 / calc->q[m]) : exp(0.5 * calc->log_fluct_sum / eval_count);
+            calc->fq[(i * calc->q_count) + m] = log2(fq);
+            calc->q_sum[m] = 0;
+        }
+        calc->log_fluct_sum = 0;
+        
+        //reset the per layer accumulators for the next layer
+        calc->block = 0;
+        calc->rs_sum = 0;
+        calc->rs_sqsum = 0;
+    }
+    
+    return 1;
+}
+
+long sc_hurst_calc_run(t_hurst_calc* calc, double budget_ms, double (*clock_ms)(void)) {
+    if(budget_ms <= 0 || clock_ms == NULL) {
+        return sc_hurst_calc_step(calc, 0, NULL);
+    }
+    
+    //layers run smallest blocks first, so the budget cuts off the largest (most expensive) block sizes.
+    //A regression needs two layers though, so those are finished whatever the budget says
+    double deadline = clock_ms() + budget_ms;
+    long done = sc_hurst_calc_step(calc, deadline, clock_ms);
+    while(done == 0 && calc->layer < 2) {
+        done = sc_hurst_calc_step(calc, deadline, clock_ms);
+    }
+    
+    return done;
+}
+
+void sc_hurst_calc_result(t_hurst_calc* calc, t_hurst_result* result) {
+    //create struct for linear regression helper function
+    t_hurst_helper_lin_reg* lr_temp = (t_hurst_helper_lin_reg*)malloc(sizeof(t_hurst_helper_lin_reg));
+    lr_temp->rs = calc->rs_avg;
+    lr_temp->size = calc->size;
+    lr_temp->var = calc->rs_var;
+    lr_temp->rs_length = calc->layer; //only the completed layers
+    lr_temp->size_length = calc->layer;
+    lr_temp->slope = 0;
+    lr_temp->slope_error = 0;
+    
+    sc_hurst_helper_linear_regression(&lr_temp);
+    
+    //detail variance of a process with exponent H scales as 2^((2H - 2) * octave)
+    double h_scale = (calc->estimator == SC_HURST_WAVELET) ? 0.5 : 1;
+    double h_offset = (calc->estimator == SC_HURST_WAVELET) ? 1 : 0;
+    
+    //the periodogram near zero goes as (4 sin^2(lambda / 2))^-d, and H = d + 1/2
+    if(calc->estimator == SC_HURST_SPECTRAL) {
+        h_scale = -1;
+        h_offset = 0.5;
+    }
+    
+    result->hurst = h_offset + (h_scale * lr_temp->slope);
+    result->error = h_scale * lr_temp->slope_error;
+    result->layer_count = calc->layer;
+    result->blocks_evaluated = calc->blocks_evaluated;
+    
+    //h(q) is the slope of log2(F_q) over the same block sizes, the history carries no fluctuations so only the window's layers count
+    result->hq_count = calc->q_count;
+    if(calc->q_count > 0) {
+        long fq_layers = (calc->layer < calc->window_layers) ? calc->layer : calc->window_layers;
+        double* fq_col = (double*)malloc(sizeof(double) * ((fq_layers > 0) ? fq_layers : 1));
+        lr_temp->rs = fq_col;
+        lr_temp->var = NULL;
+        lr_temp->rs_length = fq_layers;
+        lr_temp->size_length = fq_layers;
+        for(int m = 0; m < calc->q_count; m++) {
+            for(int i = 0; i < fq_layers; i++) {
+                fq_col[i] = calc->fq[(i * calc->q_count) + m];
+            }
+            sc_hurst_helper_linear_regression(&lr_temp);
+            result->hq[m] = h_offset + lr_temp->slope;
+        }
+        free(fq_col);
+    }
+    
+    //cleanup allocated memory
+    lr_temp->rs = NULL;
+    lr_temp->size = NULL;
+    lr_temp->var = NULL;
+    free(lr_temp);
+}
+
+void sc_hurst_calc_free(t_hurst_calc* calc) {
+    double* rs_avg = calc->rs_avg;
+    double* size = calc->size;
+    
+    free(calc->rs_var);
+    if(calc->fq != NULL) {
+        free(calc->fq);
+    }
+    free(rs_avg);
+    free(size);
+    
+    calc->src_data = NULL;
+    free(calc);
+}
+
+/*==================================================================================
+ ========================WAVELET ESTIMATOR=========================================
+ ====================================================================================*/
+
+void sc_hurst_wavelet_pass(t_hurst_calc* calc) {
+    double* approx = (double*)malloc(sizeof(double) * calc->length);
+    for(long i = 0; i < calc->length; i++) {
+        approx[i] = calc->src_data[i];
+    }
+    
+    //each octave's approximation overwrites the front of the previous one, an odd sample left over at the end is dropped
+    long length = calc->length;
+    for(long i = 0; i < calc->layer_count; i++) {
+        long half = length / 2;
+        double sqsum = 0;
+        
+        for(long k = 0; k < half; k++) {
+            double even = approx[2 * k];
+            double d = approx[(2 * k) + 1] - even; //predict the odd sample from the even one
+            approx[k] = even + (d / 2); //update keeps the running mean of the pair
+            sqsum += d * d;
+            
+            //moments of |d| for h(q), taken from the same coefficients
+            if(calc->q_count > 0) {
+                double log_d = log((fabs(d) > 0.00000001) ? fabs(d) : 0.00000001);
+                calc->log_fluct_sum += log_d;
+                for(int m = 0; m < calc->q_count; m++) {
+                    calc->q_sum[m] += exp(calc->q[m] * log_d);
+                }
+            }
+        }
+        
+        calc->rs_avg[i] = log2((sqsum > 0) ? sqsum / half : 0.00000001);
+        calc->size[i] = i + 1; //log2 of the scale, detail coefficients of octave i + 1 span 2^(i + 1) samples
+        calc->rs_var[i] = 0;
+        
+        //q-th order mean of |d|, (mean |d|^q)^(1/q), or exp(mean ln|d|) for q = 0
+        for(int m = 0; m < calc->q_count; m++) {
+            double fq = (calc->q[m] != 0) ? pow(calc->q_sum[m] / half, 1 / calc->q[m]) : exp(calc->log_fluct_sum / half);
+            calc->fq[(i * calc->q_count) + m] = log2(fq);
+            calc->q_sum[m] = 0;
+        }
+        calc->log_fluct_sum = 0;
+        
+#ifdef DEBUG
+        sc_hurst_debug_post(calc->owner, "octave: %ld, coefficients: %ld, log2var: %f", i + 1, half, calc->rs_avg[i]);
+#endif
+        
+        calc->blocks_evaluated += half;
+        length = half;
+    }
+    
+    calc->layer = calc->layer_count;
+    free(approx);
+}
+
+/*==================================================================================
+ ========================WINDOW BANK=========================================
+ ====================================================================================*/
+
+void sc_hurst_bank(double* src_data, long length, long* windows, long window_count, double* hurst) {
+    //every window is partitioned from its own start, the same way an instance with that max_length would do it.
+    //Windows whose starts differ by a multiple of a block size put their blocks of that size on one shared grid
+    long span = 0;
+    for(long w = 0; w < window_count; w++) {
+        long len = (windows[w] < length) ? windows[w] : length;
+        span = (len > span) ? len : span;
+    }
+    double* base = src_data + (length - span);
+    
+    //one grid per block size and start phase, starting where the longest window on it starts
+    long grid_capacity = window_count * SC_HURST_MAX_LEVELS;
+    long* grid_size = (long*)malloc(sizeof(long) * grid_capacity);
+    long* grid_start = (long*)malloc(sizeof(long) * grid_capacity);
+    long grid_count = 0;
+    for(long w = 0; w < window_count; w++) {
+        long len = (windows[w] < length) ? windows[w] : length;
+        long start = span - len;
+        for(long b = sc_hurst_helper_div_size(len); b <= len; b *= 2) {
+            long g = 0;
+            for(; g < grid_count && (grid_size[g] != b || (start - grid_start[g]) % b != 0); g++) {}
+            if(g == grid_count) {
+                grid_size[g] = b;
+                grid_start[g] = start;
+                grid_count++;
+            }
+            grid_start[g] = (start < grid_start[g]) ? start : grid_start[g];
+        }
+    }
+    
+    //R/S of each block once, kept as a running total so any window's layer average is one lookup
+    double** rs_total = (double**)malloc(sizeof(double*) * grid_count);
+    for(long g = 0; g < grid_count; g++) {
+        long b = grid_size[g];
+        long block_count = (span - grid_start[g]) / b;
+        rs_total[g] = (double*)malloc(sizeof(double) * (block_count + 1));
+        rs_total[g][0] = 0;
+        
+        for(long j = 0; j < block_count; j++) {
+            long idx0 = grid_start[g] + (j * b);
+            long idx1 = idx0 + b;
+            idx1 = (idx1 < span) ? idx1 : span - 1; //a window's last block stops one short of its end, as in sc_hurst_calc_step
+            
+            //each block is centered on its own mean before anything is squared or summed, as in sc_hurst_calc_step.
+            //Running sums over the whole span would cancel badly on trending data, where values dwarf their spread
+            t_hurst_helper_ms ms;
+            t_hurst_helper_ms* ms_temp = &ms;
+            ms.src_data = base;
+            ms.idx0 = idx0;
+            ms.idx1 = idx1;
+            ms.mean = 0;
+            ms.stddev = 0;
+            sc_hurst_stddev_and_mean_helper(&ms_temp, NULL);
+            
+            t_hurst_helper_rs rsa;
+            t_hurst_helper_rs* rsa_temp = &rsa;
+            rsa.src_data = base;
+            rsa.idx0 = idx0;
+            rsa.idx1 = idx1;
+            rsa.mean = ms.mean;
+            rsa.detrend = 0;
+            rsa.range = 0;
+            rsa.fluct = 0;
+            sc_hurst_helper_range(&rsa_temp);
+            
+            rs_total[g][j + 1] = rs_total[g][j] + (rsa.range / ((ms.stddev > 0) ? ms.stddev : 0.0001));
+        }
+    }
+    
+    //each window is just a regression over averages it reads out of the shared totals
+    double* rs_avg = (double*)malloc(sizeof(double) * SC_HURST_MAX_LEVELS);
+    double* size = (double*)malloc(sizeof(double) * SC_HURST_MAX_LEVELS);
+    t_hurst_helper_lin_reg* lr_temp = (t_hurst_helper_lin_reg*)malloc(sizeof(t_hurst_helper_lin_reg));
+    for(long w = 0; w < window_count; w++) {
+        long len = (windows[w] < length) ? windows[w] : length;
+        long start = span - len;
+        long layer_count = 0;
+        for(long b = sc_hurst_helper_div_size(len); b <= len; b *= 2) {
+            long g = 0;
+            for(; grid_size[g] != b || (start - grid_start[g]) % b != 0; g++) {}
+            long first = (start - grid_start[g]) / b;
+            long count = len / b;
+            rs_avg[layer_count] = log2((rs_total[g][first + count] - rs_total[g][first]) / count);
+            size[layer_count] = log2((double)b);
+            layer_count++;
+        }
+        
+        lr_temp->rs = rs_avg;
+        lr_temp->size = size;
+        lr_temp->var = NULL;
+        lr_temp->rs_length = layer_count;
+        lr_temp->size_length = layer_count;
+        lr_temp->slope = 0;
+        lr_temp->slope_error = 0;
+        sc_hurst_helper_linear_regression(&lr_temp);
+        hurst[w] = lr_temp->slope;
+    }
+    
+    free(lr_temp);
+    free(rs_avg);
+    free(size);
+    for(long g = 0; g < grid_count; g++) {
+        free(rs_total[g]);
+    }
+    free(rs_total);
+    free(grid_size);
+    free(grid_start);
+}
+
+/*==================================================================================
+ ========================SPECTRAL ESTIMATOR=========================================
+ ====================================================================================*/
+
+void sc_hurst_spectral_pass(t_hurst_calc* calc) {
+    long n = calc->div_size;
+    double* re = (double*)malloc(sizeof(double) * ((n / 2) + 1));
+    double* im = (double*)malloc(sizeof(double) * ((n / 2) + 1));
+    
+    sc_hurst_helper_real_fft(calc->src_data + (calc->length - n), n, re, im);
+    sc_hurst_spectral_fill(calc, re + 1, im + 1);
+    
+    free(re);
+    free(im);
+}
+
+void sc_hurst_spectral_fill(t_hurst_calc* calc, double* re, double* im) {
+    long n = calc->div_size;
+    
+    for(long k = 1; k <= calc->layer_count; k++) {
+        double power = ((re[k - 1] * re[k - 1]) + (im[k - 1] * im[k - 1])) / n;
+        double s = sin((SC_HURST_PI * k) / n);
+        
+        calc->rs_avg[k - 1] = log2((power > 0.00000001) ? power : 0.00000001);
+        calc->size[k - 1] = log2(4 * s * s);
+        calc->rs_var[k - 1] = 0;
+        
+#ifdef DEBUG
+        sc_hurst_debug_post(calc->owner, "bin: %ld, log2power: %f", k, calc->rs_avg[k - 1]);
+#endif
+    }
+    
+    calc->blocks_evaluated = calc->layer_count;
+    calc->layer = calc->layer_count;
+}
+
+long sc_hurst_calc_set_spectrum(t_hurst_calc* calc, t_hurst_sdft* sdft) {
+    if(calc->estimator != SC_HURST_SPECTRAL || sdft == NULL || sdft->valid == 0 || sdft->size != calc->div_size || sdft->bin_count != calc->layer_count) {
+        return 0;
+    }
+    
+    sc_hurst_spectral_fill(calc, sdft->re, sdft->im);
+    return 1;
+}
+
+t_hurst_sdft* sc_hurst_sdft_new(long size) {
+    t_hurst_sdft* sdft = (t_hurst_sdft*)malloc(sizeof(t_hurst_sdft));
+    
+    sdft->size = size;
+    sdft->bin_count = (long)pow((double)size, 0.5);
+    sdft->re = (double*)malloc(sizeof(double) * sdft->bin_count);
+    sdft->im = (double*)malloc(sizeof(double) * sdft->bin_count);
+    sdft->rot_re = (double*)malloc(sizeof(double) * sdft->bin_count);
+    sdft->rot_im = (double*)malloc(sizeof(double) * sdft->bin_count);
+    for(long k = 1; k <= sdft->bin_count; k++) {
+        sdft->rot_re[k - 1] = cos((2 * SC_HURST_PI * k) / size);
+        sdft->rot_im[k - 1] = sin((2 * SC_HURST_PI * k) / size);
+    }
+    sdft->valid = 0;
+    sdft->updates = 0;
+    
+    return sdft;
+}
+
+void sc_hurst_sdft_sync(t_hurst_sdft* sdft, double* span) {
+    double* re = (double*)malloc(sizeof(double) * ((sdft->size / 2) + 1));
+    double* im = (double*)malloc(sizeof(double) * ((sdft->size / 2) + 1));
+    
+    sc_hurst_helper_real_fft(span, sdft->size, re, im);
+    for(long k = 1; k <= sdft->bin_count; k++) {
+        sdft->re[k - 1] = re[k];
+        sdft->im[k - 1] = im[k];
+    }
+    
+    free(re);
+    free(im);
+    
+    sdft->valid = 1;
+    sdft->updates = 0;
+}
+
+void sc_hurst_sdft_slide(t_hurst_sdft* sdft, double old_value, double new_value) {
+    //X_k <- (X_k - old + new) * e^(i 2 pi k / size), the span moves one sample without touching the rest of it
+    double delta = new_value - old_value;
+    for(long k = 0; k < sdft->bin_count; k++) {
+        double r = sdft->re[k] + delta;
+        double i = sdft->im[k];
+        sdft->re[k] = (r * sdft->rot_re[k]) - (i * sdft->rot_im[k]);
+        sdft->im[k] = (r * sdft->rot_im[k]) + (i * sdft->rot_re[k]);
+    }
+    sdft->updates++;
+}
+
+void sc_hurst_sdft_free(t_hurst_sdft* sdft) {
+    free(sdft->re);
+    free(sdft->im);
+    free(sdft->rot_re);
+    free(sdft->rot_im);
+    free(sdft);
+}
+
+/*==================================================================================
+ ========================HISTORY PYRAMID=========================================
+ ====================================================================================*/
+
+t_hurst_pyramid* sc_hurst_pyramid_new(long base_size, long window, double horizon) {
+    t_hurst_pyramid* p = (t_hurst_pyramid*)malloc(sizeof(t_hurst_pyramid));
+    
+    p->staging = NULL;
+    p->horizon = horizon;
+    p->history.base_size = base_size;
+    p->filled = NULL;
+    p->filled_size = NULL;
+    p->filled_count = 0;
+    p->filled_capacity = 0;
+    
+    sc_hurst_pyramid_clear(p);
+    sc_hurst_pyramid_resize(p, window);
+    
+    return p;
+}
+
+void sc_hurst_pyramid_push(t_hurst_pyramid* p, double* values, long count) {
+    while(count > 0) {
+        long room = p->staging_size - p->staging_length;
+        long take = (count < room) ? count : room;
+        
+        double* dst = p->staging + p->staging_length;
+        for(long i = 0; i < take; i++) {
+            dst[i] = values[i];
+        }
+        p->staging_length += take;
+        values += take;
+        count -= take;
+        
+        if(p->staging_length < p->staging_size) {
+            return;
+        }
+        
+        //evaluating the block costs as much as a calculation over the window, so it's only queued here
+        if(p->filled_count == p->filled_capacity) {
+            p->filled_capacity = (p->filled_capacity > 0) ? p->filled_capacity * 2 : 4;
+            p->filled = (double**)realloc(p->filled, sizeof(double*) * p->filled_capacity);
+            p->filled_size = (long*)realloc(p->filled_size, sizeof(long) * p->filled_capacity);
+        }
+        p->filled[p->filled_count] = p->staging;
+        p->filled_size[p->filled_count] = p->staging_size;
+        p->filled_count++;
+        
+        p->staging = (double*)malloc(sizeof(double) * p->staging_size);
+        p->staging_length = 0;
+    }
+}
+
+double* sc_hurst_pyramid_take(t_hurst_pyramid* p, long* size) {
+    if(p->filled_count == 0) {
+        return NULL;
+    }
+    
+    double* block = p->filled[0];
+    *size = p->filled_size[0];
+    p->filled_count--;
+    for(long i = 0; i < p->filled_count; i++) {
+        p->filled[i] = p->filled[i + 1];
+        p->filled_size[i] = p->filled_size[i + 1];
+    }
+    
+    return block;
+}
+
+void sc_hurst_pyramid_evaluate(double* block, long size, long base_size, double horizon, t_hurst_staged* staged) {
+    staged->level = 0;
+    while(base_size * pow(2, staged->level + 1) <= size) {
+        staged->level++;
+    }
+    
+    //every block size that fits in the staging block is evaluated exactly, the same way a window's blocks are
+    for(long level = 0; level <= staged->level; level++) {
+        long block_size = pow(2, level) * base_size;
+        double decay = exp(-block_size / horizon);
+        staged->rs_sum[level] = 0;
+        staged->weight[level] = 0;
+        staged->decay[level] = 1;
+        
+        for(long j = 0; j + block_size <= size; j += block_size) {
+            t_hurst_helper_ms ms;
+            t_hurst_helper_ms* ms_temp = &ms;
+            ms.src_data = block;
+            ms.idx0 = j;
+            ms.idx1 = j + block_size;
+            ms.mean = 0;
+            ms.stddev = 0;
+            sc_hurst_stddev_and_mean_helper(&ms_temp, NULL);
+            
+            t_hurst_helper_rs rsa;
+            t_hurst_helper_rs* rsa_temp = &rsa;
+            rsa.src_data = block;
+            rsa.idx0 = j;
+            rsa.idx1 = j + block_size;
+            rsa.mean = ms.mean;
+            rsa.detrend = 0;
+            rsa.range = 0;
+            rsa.fluct = 0;
+            sc_hurst_helper_range(&rsa_temp);
+            
+            //same exponential forgetting as sc_hurst_pyramid_add, one block at a time
+            staged->rs_sum[level] = (staged->rs_sum[level] * decay) + (rsa.range / ((ms.stddev > 0) ? ms.stddev : 0.0001));
+            staged->weight[level] = (staged->weight[level] * decay) + 1;
+            staged->decay[level] *= decay;
+        }
+    }
+    
+    //larger block sizes only ever see the staging block through its summary
+    sc_hurst_aggregate_block(block, size, &staged->block);
+    
+    free(block);
+}
+
+void sc_hurst_pyramid_apply(t_hurst_pyramid* p, t_hurst_staged* staged) {
+    for(long level = 0; level <= staged->level; level++) {
+        p->history.rs_sum[level] = (p->history.rs_sum[level] * staged->decay[level]) + staged->rs_sum[level];
+        p->history.weight[level] = (p->history.weight[level] * staged->decay[level]) + staged->weight[level];
+    }
+    if(staged->level >= p->history.level_count) {
+        p->history.level_count = staged->level + 1;
+    }
+    
+    //pending blocks below this one are left from a smaller staging size and can no longer pair with anything, their own levels already hold their R/S.
+    //Clearing them here rather than in sc_hurst_pyramid_resize keeps blocks queued before a resize carrying as they would have
+    for(long level = 0; level < staged->level; level++) {
+        p->has_pending[level] = 0;
+    }
+    
+    sc_hurst_pyramid_carry(p, staged->level, &staged->block);
+}
+
+void sc_hurst_pyramid_settle(t_hurst_pyramid* p) {
+    long size = 0;
+    double* block;
+    while((block = sc_hurst_pyramid_take(p, &size)) != NULL) {
+        t_hurst_staged staged;
+        sc_hurst_pyramid_evaluate(block, size, p->history.base_size, p->horizon, &staged);
+        sc_hurst_pyramid_apply(p, &staged);
+    }
+}
+
+void sc_hurst_pyramid_resize(t_hurst_pyramid* p, long window) {
+    double* staged = p->staging;
+    long staged_length = (staged != NULL) ? p->staging_length : 0;
+    
+    //the staging block is evaluated exactly, so it's kept no larger than the window itself
+    p->staging_size = p->history.base_size;
+    p->staging_level = 0;
+    while(p->staging_size * 2 <= window && p->staging_level < SC_HURST_MAX_LEVELS - 1) {
+        p->staging_size *= 2;
+        p->staging_level++;
+    }
+    p->staging = (double*)malloc(sizeof(double) * p->staging_size);
+    p->staging_length = 0;
+    
+    //staged samples are the newest evicted data, they go through the new staging block as if they had just left the window
+    if(staged != NULL) {
+        sc_hurst_pyramid_push(p, staged, staged_length);
+        free(staged);
+    }
+}
+
+void sc_hurst_pyramid_clear(t_hurst_pyramid* p) {
+    p->staging_length = 0;
+    p->history.level_count = 0;
+    for(int i = 0; i < SC_HURST_MAX_LEVELS; i++) {
+        p->history.rs_sum[i] = 0;
+        p->history.weight[i] = 0;
+        p->has_pending[i] = 0;
+    }
+    for(long i = 0; i < p->filled_count; i++) {
+        free(p->filled[i]);
+    }
+    p->filled_count = 0;
+}
+
+void sc_hurst_pyramid_free(t_hurst_pyramid* p) {
+    for(long i = 0; i < p->filled_count; i++) {
+        free(p->filled[i]);
+    }
+    free(p->filled);
+    free(p->filled_size);
+    free(p->staging);
+    free(p);
+}
+
+void sc_hurst_pyramid_add(t_hurst_pyramid* p, long level, double rs) {
+    //exponential forgetting keeps every level's totals O(1) however long the stream runs
+    double decay = exp(-(pow(2, level) * p->history.base_size) / p->horizon);
+    p->history.rs_sum[level] = (p->history.rs_sum[level] * decay) + rs;
+    p->history.weight[level] = (p->history.weight[level] * decay) + 1;
+    if(level >= p->history.level_count) {
+        p->history.level_count = level + 1;
+    }
+}
+
+void sc_hurst_pyramid_carry(t_hurst_pyramid* p, long level, t_hurst_aggregate* block) {
+    t_hurst_aggregate carry = *block;
+    
+    while(1) {
+        if(p->has_pending[level] == 0) {
+            p->pending[level] = carry;
+            p->has_pending[level] = 1;
+            return;
+        }
+        
+        t_hurst_aggregate merged;
+        sc_hurst_aggregate_merge(&p->pending[level], &carry, &merged);
+        p->has_pending[level] = 0;
+        level++;
+        
+        //no block is ever larger than the horizon
+        if(level >= SC_HURST_MAX_LEVELS || pow(2, level) * p->history.base_size > p->horizon) {
+            return;
+        }
+        
+        sc_hurst_pyramid_add(p, level, sc_hurst_aggregate_rs(&merged));
+        carry = merged;
+    }
+}
+
+void sc_hurst_aggregate_block(double* src_data, long length, t_hurst_aggregate* block) {
+    double sum = 0;
+    double sumsq = 0;
+    for(long i = 0; i < length; i++) {
+        sum += src_data[i];
+        sumsq += src_data[i] * src_data[i];
+    }
+    double mean = sum / length;
+    
+    double t = 0;
+    block->dev_max = src_data[0] - mean;
+    block->dev_min = block->dev_max;
+    block->pos_max = 1;
+    block->pos_min = 1;
+    for(long i = 0; i < length; i++) {
+        t += src_data[i] - mean;
+        if(t > block->dev_max) {
+            block->dev_max = t;
+            block->pos_max = i + 1;
+        } else if(t < block->dev_min) {
+            block->dev_min = t;
+            block->pos_min = i + 1;
+        }
+    }
+    
+    block->count = length;
+    block->sum = sum;
+    block->sumsq = sumsq;
+}
+
+double sc_hurst_aggregate_rs(t_hurst_aggregate* block) {
+    double mean = block->sum / block->count;
+    double var = (block->sumsq / block->count) - (mean * mean);
+    double stddev = (var > 0) ? pow(var, 0.5) : 0;
+    return (block->dev_max - block->dev_min) / ((stddev > 0) ? stddev : 0.0001);
+}
+
+void sc_hurst_aggregate_merge(t_hurst_aggregate* left, t_hurst_aggregate* right, t_hurst_aggregate* merged) {
+    double count = left->count + right->count;
+    double mean = (left->sum + right->sum) / count;
+    double left_shift = (left->sum / left->count) - mean; //slope the left half's profile picks up under the merged mean
+    double right_shift = (right->sum / right->count) - mean;
+    double join = left->sum - (mean * left->count); //merged profile where the right half starts
+    
+    //the merged profile's extremes are taken from the halves' extremes re-based on the merged mean, plus the join itself
+    double value[5];
+    double pos[5];
+    value[0] = left->dev_max + (left_shift * left->pos_max);
+    pos[0] = left->pos_max;
+    value[1] = left->dev_min + (left_shift * left->pos_min);
+    pos[1] = left->pos_min;
+    value[2] = join;
+    pos[2] = left->count;
+    value[3] = join + right->dev_max + (right_shift * right->pos_max);
+    pos[3] = left->count + right->pos_max;
+    value[4] = join + right->dev_min + (right_shift * right->pos_min);
+    pos[4] = left->count + right->pos_min;
+    
+    merged->dev_max = value[0];
+    merged->pos_max = pos[0];
+    merged->dev_min = value[0];
+    merged->pos_min = pos[0];
+    for(int i = 1; i < 5; i++) {
+        if(value[i] > merged->dev_max) {
+            merged->dev_max = value[i];
+            merged->pos_max = pos[i];
+        }
+        if(value[i] < merged->dev_min) {
+            merged->dev_min = value[i];
+            merged->pos_min = pos[i];
+        }
+    }
+    
+    merged->count = count;
+    merged->sum = left->sum + right->sum;
+    merged->sumsq = left->sumsq + right->sumsq;
+}
+
+/*==================================================================================
+ ========================HELPER FUNCTIONS=========================================
+ ====================================================================================*/
+
+void sc_hurst_stddev_and_mean_helper(t_hurst_helper_ms** x, void* t){
+    double* temp = (*x)->src_data + (*x)->idx0;
+    //for(int i = 0; i < (*x)->idx0; i++, temp++) {} //move to idx0
+    double* t2 = temp;
+    
+    long length = (*x)->idx1 - (*x)->idx0;
+    
+    //calculate mean
+    double sum = 0;
+    for(int i = 0; i < length; i++, t2++) {
+        sum += *t2;
+    }
+    
+#ifdef DEBUG
+    sc_hurst_debug_post(t, "length: %ld, sum: %f", length, sum);
+#endif
+    
+    double mean = sum / ((double)length);
+    
+    //calculate standard deviation
+    double stddev_sum = 0;
+    for(int i = 0; i < length; i++, temp++) {
+        stddev_sum += pow((*temp - mean), 2);
+    }
+    
+    double stddev = pow((stddev_sum * (1 / ((double)length))), 0.5);
+    
+    (*x)->mean = mean;
+    (*x)->stddev = stddev;
+    
+#ifdef DEBUG
+    sc_hurst_debug_post(t, "idx0: %ld, idx1: %ld, mean: %f, stddev: %f", (*x)->idx0, (*x)->idx1, mean, stddev);
+#endif
+}
+
+void sc_hurst_helper_range(t_hurst_helper_rs** x) {
+    double* temp = (*x)->src_data + (*x)->idx0;
+    //for(int i = 0; i < (*x)->idx0; i++, temp++){} //move to the starting index
+    long length = (*x)->idx1 - (*x)->idx0;
+    
+    double min = *temp - (*x)->mean;
+    double max = *temp - (*x)->mean;
+    
+    double t = 0;
+    if((*x)->detrend != 1) {
+        for(int i = 0; i < length; i++, temp++) {
+            t += (*temp - (*x)->mean); //t'(n) = (t(n) - mean) + t'(n-1)
+            if(t > max) {
+                max = t;
+            } else if(t < min) {
+                min = t;
+            }
+        }
+        (*x)->range = max - min;
+        return;
+    }
+    
+    //t' is also the block's profile, so the sums for its least squares line are gathered in the same pass
+    double sum_y = 0;
+    double sum_yy = 0;
+    double sum_ny = 0;
+    for(int i = 0; i < length; i++, temp++) {
+        t += (*temp - (*x)->mean); //t'(n) = (t(n) - mean) + t'(n-1)
+        if(t > max) {
+            max = t;
+        } else if(t < min) {
+            min = t;
+        }
+        sum_y += t;
+        sum_yy += t * t;
+        sum_ny += i * t;
+    }
+    (*x)->range = max - min;
+    
+    //residual sum of squares around the line is Syy - Sny^2 / Snn, with everything centered
+    double n = (double)length;
+    double snn = (n * ((n * n) - 1)) / 12;
+    double sny = sum_ny - (((n - 1) / 2) * sum_y);
+    double syy = sum_yy - ((sum_y * sum_y) / n);
+    double ssr = (snn > 0) ? syy - ((sny * sny) / snn) : 0;
+    (*x)->fluct = (ssr > 0) ? ssr / n : 0;
+}
+
+void sc_hurst_helper_linear_regression(t_hurst_helper_lin_reg** x){
+    double* s = (*x)->size; //x-axis values
+    double* r = (*x)->rs; //y-axis values
+    double length = (*x)->rs_length;
+    double sumx = 0;
+    double sumy = 0;
+    double sumxsq = 0;
+    double sumxy = 0;
+    
+    for(int i = 0; i < length; i++, s++, r++){
+        sumx += *s;
+        sumy += *r;
+        sumxsq += pow(*s, 2);
+        sumxy += *s * *r;
+    }
+    
+    double denom = (length * sumxsq) - pow(sumx, 2);
+    double slope = ((length * sumxy) - (sumx * sumy)) / denom;
+    
+    //slope is a weighted sum of the y values, so their variances propagate through the squared weights
+    double slope_var = 0;
+    if((*x)->var != NULL) {
+        double mean_x = sumx / length;
+        double sxx = denom / length;
+        s = (*x)->size;
+        double* v = (*x)->var;
+        for(int i = 0; i < length; i++, s++, v++) {
+            double w = (*s - mean_x) / sxx;
+            slope_var += w * w * *v;
+        }
+    }
+    
+    (*x)->slope = slope;
+    (*x)->slope_error = pow(slope_var, 0.5);
+}
+
+long sc_hurst_helper_div_size(long length) {
+    if(length < 64) {
+        return 2;
+    } else if(length < 128) {
+        return 4;
+    } else if(length < 256) {
+        return 6;
+    }
+    return 8;
+}
+
+long sc_hurst_helper_spectral_size(long length) {
+    long size = 2;
+    while(size * 2 <= length) {
+        size *= 2;
+    }
+    return size;
+}
+
+void sc_hurst_helper_fft(double* re, double* im, long n) {
+    //bit reversed reordering
+    for(long i = 1, j = 0; i < n; i++) {
+        long bit = n >> 1;
+        for(; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if(i < j) {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    
+    //butterflies, the twiddle factor is advanced by recurrence within each stage
+    for(long len = 2; len <= n; len <<= 1) {
+        double w_re = cos((-2 * SC_HURST_PI) / len);
+        double w_im = sin((-2 * SC_HURST_PI) / len);
+        long half = len / 2;
+        for(long i = 0; i < n; i += len) {
+            double c_re = 1;
+            double c_im = 0;
+            for(long k = 0; k < half; k++) {
+                long a = i + k;
+                long b = a + half;
+                double t_re = (re[b] * c_re) - (im[b] * c_im);
+                double t_im = (re[b] * c_im) + (im[b] * c_re);
+                re[b] = re[a] - t_re;
+                im[b] = im[a] - t_im;
+                re[a] += t_re;
+                im[a] += t_im;
+                
+                double next_re = (c_re * w_re) - (c_im * w_im);
+                c_im = (c_re * w_im) + (c_im * w_re);
+                c_re = next_re;
+            }
+        }
+    }
+}
+
+void sc_hurst_helper_real_fft(double* src_data, long n, double* re, double* im) {
+    long half = n / 2;
+    double* z_re = (double*)malloc(sizeof(double) * half);
+    double* z_im = (double*)malloc(sizeof(double) * half);
+    
+    //even samples as the real part and odd samples as the imaginary part of a half length transform
+    for(long k = 0; k < half; k++) {
+        z_re[k] = src_data[2 * k];
+        z_im[k] = src_data[(2 * k) + 1];
+    }
+    sc_hurst_helper_fft(z_re, z_im, half);
+    
+    //split it back into the even and odd transforms, X_k = E_k + e^(-i 2 pi k / n) O_k
+    for(long k = 0; k <= half; k++) {
+        long a = k % half;
+        long b = (half - k) % half;
+        double e_re = (z_re[a] + z_re[b]) / 2;
+        double e_im = (z_im[a] - z_im[b]) / 2;
+        double o_re = (z_im[a] + z_im[b]) / 2;
+        double o_im = (z_re[b] - z_re[a]) / 2;
+        double w_re = cos((-2 * SC_HURST_PI * k) / n);
+        double w_im = sin((-2 * SC_HURST_PI * k) / n);
+        re[k] = e_re + ((w_re * o_re) - (w_im * o_im));
+        im[k] = e_im + ((w_re * o_im) + (w_im * o_re));
+    }
+    
+    free(z_re);
+    free(z_im);
+}
+
+long sc_hurst_helper_block_index(long k, long eval_count, long layer_size) {
+    if(eval_count >= layer_size) {
+        return k;
+    }
+    //midpoint of the k-th of eval_count equally sized strata, so the subset is deterministic and spread over the whole series
+    return (long)(((2 * (long long)k + 1) * layer_size) / (2 * (long long)eval_count));
+}
@@ -0,0 +1,217 @@
+//
+//  sc.hurst.calc.h
+//  max-external
+//
+//  Hurst exponent calculation shared by the sc.hurst external and the sc.hurst.cli tool.
+//  Nothing here depends on the Max SDK.
+//
+
+#ifndef SC_HURST_CALC_H
+#define SC_HURST_CALC_H
+
+//#define DEBUG
+
+#define SC_HURST_MAX_Q 16   //most moments qlist can hold
+#define SC_HURST_MAX_LEVELS 48  //most block sizes the history pyramid can hold
+#define SC_HURST_MAX_WINDOWS 16 //most horizons a window bank can hold
+
+//estimators a calculation can use
+#define SC_HURST_RS 0       //rescaled range over dyadic blocks
+#define SC_HURST_WAVELET 1  //variance of haar detail coefficients per octave
+#define SC_HURST_SPECTRAL 2 //slope of the low frequency periodogram (GPH)
+
+#define SC_HURST_PI 3.14159265358979323846
+
+//===================HELPER STRUCTS====================
+
+//sent to the helper thread for calculating the mean and standard deviation
+typedef struct _sc_hurst_helper_in
+{
+    double* src_data;
+    long idx0;
+    long idx1;
+    double mean; //filled in by thread (should start as 0)
+    double stddev; //filled in by thread (should start as 0)
+} t_hurst_helper_ms;
+
+//sent to the helper thread for calculating the range
+typedef struct _sc_hurst_helper_range
+{
+    double* src_data;
+    long idx0;
+    long idx1;
+    double mean;
+    long detrend; //when 1, fluct is computed in the same pass as range
+    double range; //filled in by thread (should start as 0)
+    double fluct; //mean squared residual of the block's profile around its linear trend, filled in by thread when detrend is 1
+} t_hurst_helper_rs;
+
+//sent to linear regression helper function (should be passed as mutable to allow the slope member to be set in the function)
+typedef struct _sc_hurst_helper_lin_reg
+{
+    double* rs; //pointer to array of log2(R(n)/S(n))
+    double* size; //pointer to array of log2(block_size)
+    double* var; //pointer to array of variances of each rs value (may be NULL if every block was evaluated)
+    long rs_length; //length of rs array
+    long size_length; //length of block_size array
+    double slope; //slope of the best fit line, filled in by helper function
+    double slope_error; //standard error of the slope propagated from var, filled in by helper function (0 if var is NULL)
+} t_hurst_helper_lin_reg;
+
+//result of a single pass over the data set
+typedef struct _sc_hurst_result
+{
+    double hurst; //estimated hurst exponent
+    double error; //standard error of the estimate caused by block subsampling (0 when every block is evaluated)
+    long layer_count; //number of block sizes used in the regression
+    long blocks_evaluated; //number of blocks evaluated across all layers
+    double hq[SC_HURST_MAX_Q]; //generalized hurst exponent for each requested q
+    long hq_count; //number of values in hq
+} t_hurst_result;
+
+//R/S totals for each block size, carried in from data that has left the window
+typedef struct _sc_hurst_history
+{
+    long base_size; //block size of level 0, every level above doubles it
+    long level_count; //number of levels that have seen at least one block
+    double rs_sum[SC_HURST_MAX_LEVELS]; //decayed sum of the R/S of each level's blocks
+    double weight[SC_HURST_MAX_LEVELS]; //decayed number of blocks behind rs_sum
+} t_hurst_history;
+
+//summary of a block that is enough to merge it with its neighbour, positions count samples from the start of the block
+typedef struct _sc_hurst_aggregate
+{
+    double count;
+    double sum;
+    double sumsq;
+    double dev_max; //highest point of the block's cumulative deviation from its own mean
+    double dev_min; //lowest point of the same
+    double pos_max; //where dev_max was reached
+    double pos_min; //where dev_min was reached
+} t_hurst_aggregate;
+
+//multi-resolution history of everything that has left the window. Evicted samples collect in a staging
+//block whose sub-blocks are evaluated exactly, larger blocks are built by merging aggregates pairwise
+typedef struct _sc_hurst_pyramid
+{
+    t_hurst_history history;
+    double horizon; //samples after which a block's weight has decayed to 1/e, also the largest block size
+    double* staging; //evicted samples waiting to fill a block of staging_size
+    long staging_size;
+    long staging_length;
+    long staging_level; //level whose block size is staging_size
+    t_hurst_aggregate pending[SC_HURST_MAX_LEVELS]; //left half waiting for its right neighbour, one per level
+    long has_pending[SC_HURST_MAX_LEVELS];
+    double** filled; //staging blocks that filled up and wait to be evaluated, oldest first
+    long* filled_size;
+    long filled_count;
+    long filled_capacity;
+} t_hurst_pyramid;
+
+//exact evaluation of one filled staging block, made apart from the pyramid so it can run without holding up whoever pushes
+typedef struct _sc_hurst_staged
+{
+    long level; //level of the whole block, every level up to it was evaluated
+    double rs_sum[SC_HURST_MAX_LEVELS]; //R/S of each level's blocks, decayed as if they had been added one by one
+    double weight[SC_HURST_MAX_LEVELS];
+    double decay[SC_HURST_MAX_LEVELS]; //decay the level's earlier totals pick up over the same blocks
+    t_hurst_aggregate block; //summary of the whole block, carried up from its level
+} t_hurst_staged;
+
+//low frequency bins of the DFT over the newest size samples, slid along one sample at a time
+typedef struct _sc_hurst_sdft
+{
+    long size; //span of the transform, a power of two
+    long bin_count; //bins 1 to bin_count are kept, the ones the spectral estimator regresses over
+    double* re; //real part of each kept bin
+    double* im; //imaginary part of each kept bin
+    double* rot_re; //e^(i 2 pi k / size) for each kept bin, the rotation applied on every slide
+    double* rot_im;
+    long valid; //0 until synced with the data, and again once the data changes some other way
+    long updates; //slides since the last sync, rounding error builds up with each one
+} t_hurst_sdft;
+
+//state of a calculation that can be stopped after any block and resumed later
+typedef struct _sc_hurst_calc
+{
+    void* owner; //whoever started the calculation, handed back to sc_hurst_debug_post
+    double* src_data; //pointer to the data being evaluated
+    long length; //length of src_data
+    long max_blocks; //block budget per layer (0 evaluates every block)
+    long estimator; //SC_HURST_RS, SC_HURST_WAVELET or SC_HURST_SPECTRAL
+    long div_size; //smallest block size (span of the transform for the spectral estimator)
+    long layer_count; //number of layers to evaluate
+    long layer; //layer currently being evaluated, equal to the number of completed layers
+    long block; //next block to evaluate within the current layer
+    double rs_sum; //running sum of R/S for the current layer
+    double rs_sqsum; //running sum of squared R/S for the current layer
+    long blocks_evaluated; //number of blocks evaluated in completed layers
+    double* rs_avg; //log2 of the average R/S of each completed layer (log2 of the mean squared detail coefficient for the wavelet estimator)
+    double* size; //log2 of the block size of each layer (of the octave's scale for the wavelet estimator)
+    double* rs_var; //variance of each rs_avg value
+    long q_count; //number of moments for the generalized exponents (0 for none)
+    double q[SC_HURST_MAX_Q]; //the moments themselves
+    double q_half[SC_HURST_MAX_Q]; //q / 2, the power F^2 is raised to (0 for q = 0)
+    double q_sum[SC_HURST_MAX_Q]; //running sum of (F^2)^(q/2) for the current layer
+    double log_fluct_sum; //running sum of ln(F^2) for the current layer, used for q = 0
+    double* fq; //log2 of the q-th order fluctuation function, q_count values per completed layer
+    long window_layers; //layers with at least one block inside src_data, the rest come from history alone
+    long has_history; //1 when history is folded into each layer's average
+    t_hurst_history history; //copied when the calculation starts, so the pyramid can keep changing underneath it
+} t_hurst_calc;
+
+//===================FUNTCTION PROTOTYPES==============
+
+//resumable calculation state
+t_hurst_calc* sc_hurst_calc_new(void* owner, double* src_data, long length, long max_blocks, double* qlist, long qlist_count, t_hurst_history* history, long estimator); //plans the layers of a calculation over src_data (history may be NULL, only R/S uses it)
+long sc_hurst_calc_step(t_hurst_calc* calc, double deadline, double (*clock_ms)(void)); //evaluates blocks until done (returns 1) or clock_ms() passes deadline (returns 0). deadline of 0 never yields
+long sc_hurst_calc_run(t_hurst_calc* calc, double budget_ms, double (*clock_ms)(void)); //runs every layer, or stops once budget_ms is spent and at least two layers are done (returns 0 if it stopped early). budget_ms of 0 runs every layer
+void sc_hurst_calc_result(t_hurst_calc* calc, t_hurst_result* result); //regression over the layers completed so far
+void sc_hurst_calc_free(t_hurst_calc* calc);
+
+//wavelet estimator
+void sc_hurst_wavelet_pass(t_hurst_calc* calc); //one in-place haar lifting pass over a copy of src_data, filling every layer at once
+
+//spectral estimator
+void sc_hurst_spectral_pass(t_hurst_calc* calc); //real FFT of the newest div_size samples, filling every layer at once
+void sc_hurst_spectral_fill(t_hurst_calc* calc, double* re, double* im); //log periodogram of bins 1 to layer_count, re and im start at bin 1
+long sc_hurst_calc_set_spectrum(t_hurst_calc* calc, t_hurst_sdft* sdft); //takes the bins from a synced sliding DFT over the same span instead of running the FFT, returns 1 if it could
+t_hurst_sdft* sc_hurst_sdft_new(long size);
+void sc_hurst_sdft_sync(t_hurst_sdft* sdft, double* span); //recomputes every kept bin from the newest size samples
+void sc_hurst_sdft_slide(t_hurst_sdft* sdft, double old_value, double new_value); //old_value leaves the front of the span, new_value joins the end
+void sc_hurst_sdft_free(t_hurst_sdft* sdft);
+
+//window bank
+void sc_hurst_bank(double* src_data, long length, long* windows, long window_count, double* hurst); //R/S exponent over the newest windows[i] samples for each i, evaluating blocks that coincide between windows once
+
+//long horizon history
+t_hurst_pyramid* sc_hurst_pyramid_new(long base_size, long window, double horizon); //staging block is the largest base_size * 2^k that fits in window
+void sc_hurst_pyramid_push(t_hurst_pyramid* p, double* values, long count); //adds samples that have just left the window, oldest first. Filled staging blocks are only queued
+double* sc_hurst_pyramid_take(t_hurst_pyramid* p, long* size); //oldest queued block and its size, NULL when there is none. The caller owns the block
+void sc_hurst_pyramid_evaluate(double* block, long size, long base_size, double horizon, t_hurst_staged* staged); //exact R/S of every level within a taken block, frees the block
+void sc_hurst_pyramid_apply(t_hurst_pyramid* p, t_hurst_staged* staged); //folds an evaluated block into the totals, in the order the blocks were taken
+void sc_hurst_pyramid_settle(t_hurst_pyramid* p); //takes, evaluates and applies every queued block
+void sc_hurst_pyramid_resize(t_hurst_pyramid* p, long window); //fits the staging block to a new window, carrying on with the totals, the pending and queued blocks and the staged samples
+void sc_hurst_pyramid_clear(t_hurst_pyramid* p);
+void sc_hurst_pyramid_free(t_hurst_pyramid* p);
+void sc_hurst_pyramid_add(t_hurst_pyramid* p, long level, double rs); //decays a level's totals by one block and adds rs
+void sc_hurst_pyramid_carry(t_hurst_pyramid* p, long level, t_hurst_aggregate* block); //pairs block with the level's pending block, merging upward
+void sc_hurst_aggregate_block(double* src_data, long length, t_hurst_aggregate* block); //exact summary of length samples
+double sc_hurst_aggregate_rs(t_hurst_aggregate* block); //rescaled range of a summarised block
+void sc_hurst_aggregate_merge(t_hurst_aggregate* left, t_hurst_aggregate* right, t_hurst_aggregate* merged); //range of the merged block is estimated from the halves' extremes
+
+//helper functions for calculations
+void sc_hurst_stddev_and_mean_helper(t_hurst_helper_ms** x, void* t); //calculating mean and standard deviation. (requires mutable struct pointer)
+void sc_hurst_helper_range(t_hurst_helper_rs** x); //calculating the rescaled range (requires mutable struct pointer)
+void sc_hurst_helper_linear_regression(t_hurst_helper_lin_reg** x); //helper function to calculate linear regression of each block size
+long sc_hurst_helper_div_size(long length); //smallest block size used for a data set of the given length
+long sc_hurst_helper_spectral_size(long length); //span of the spectral estimator's transform, the largest power of two <= length
+void sc_hurst_helper_fft(double* re, double* im, long n); //in-place radix-2 complex FFT, n a power of two
+void sc_hurst_helper_real_fft(double* src_data, long n, double* re, double* im); //bins 0 to n / 2 of n real samples through one FFT of n / 2
+long sc_hurst_helper_block_index(long k, long eval_count, long layer_size); //index of the k-th block evaluated in a layer
+
+#ifdef DEBUG
+void sc_hurst_debug_post(void* owner, const char* fmt, ...); //defined by whatever links the calculation in, owner is the pointer given to sc_hurst_calc_new
+#endif
+
+#endif
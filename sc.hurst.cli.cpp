@@ -0,0 +1,543 @@
+//
+//  sc.hurst.cli.cpp
+//  max-external
+//
+//  Command line version of sc.hurst for batch jobs on machines without Max. Runs the same calculation as the
+//  external over a sliding window and writes one estimate per line.
+//
+//  POSIX only (mmap and pthreads). Build with:
+//      c++ -O3 -pthread sc.hurst.cli.cpp sc.hurst.calc.cpp -o sc.hurst.cli
+//
+
+#include "sc.hurst.calc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SC_HURST_CLI_CHUNK 1048576      //samples read from a stream between rounds of windows
+#define SC_HURST_CLI_ROUND 65536        //most windows evaluated in one round
+#define SC_HURST_CLI_GRAIN 64           //windows a thread takes from a round at once
+#define SC_HURST_CLI_TEXT 65536         //size of the csv read buffer
+
+//=====================OPTIONS==================
+typedef struct _sc_hurst_cli_opts
+{
+    const char* input; //path of the input file, NULL for stdin
+    const char* output; //path of the output file, NULL for stdout
+    const char* format; //f64, f32 or csv
+    long max_length; //window length, same as the external's max_length
+    long hop; //samples between estimates
+    long max_blocks; //block budget per layer, same as the external's max_blocks_per_layer (0 evaluates every block)
+    double qlist[SC_HURST_MAX_Q]; //moments of the generalized exponents, same as the external's qlist
+    long qlist_count;
+    long estimator; //SC_HURST_RS, SC_HURST_WAVELET or SC_HURST_SPECTRAL, same as the external's estimator
+    long thread_count; //threads evaluating windows
+} t_hurst_cli_opts;
+
+//=====================INPUT==================
+typedef struct _sc_hurst_cli_reader
+{
+    const char* format; //f64, f32 or csv
+    FILE* stream; //stream being read, NULL when reading a mapped file
+    const unsigned char* mapped; //mapped file, NULL when reading a stream
+    size_t mapped_size; //length of mapped in bytes
+    size_t position; //bytes of mapped consumed so far
+    char* text; //csv text read but not parsed yet
+    long text_length;
+    long text_pos; //start of the unparsed text
+    long skipped; //csv tokens that weren't numbers
+    int eof;
+} t_hurst_cli_reader;
+
+//=====================WINDOWS==================
+
+//one round of windows, all of which end inside the samples currently in view
+typedef struct _sc_hurst_cli_round
+{
+    t_hurst_cli_opts* opts;
+    const double* view; //samples in view
+    long view_base; //index of view[0] within the whole series
+    long first_end; //end (exclusive) of the first window in the round
+    long window_count;
+    long next; //next window to hand out (guarded by lock)
+    pthread_mutex_t lock;
+    t_hurst_result* results; //one per window, layer_count is 0 for windows too short to estimate
+} t_hurst_cli_round;
+
+//===================FUNTCTION PROTOTYPES==============
+int sc_hurst_cli_parse(t_hurst_cli_opts* opts, int argc, char** argv); //returns 0 on success
+void sc_hurst_cli_usage(void);
+long sc_hurst_cli_read(t_hurst_cli_reader* r, double* dst, long max_count); //returns the number of samples read, 0 at the end of input
+long sc_hurst_cli_read_text(t_hurst_cli_reader* r, double* dst, long max_count);
+void sc_hurst_cli_run_round(t_hurst_cli_round* round); //evaluates every window of the round on opts->thread_count threads
+void* sc_hurst_cli_worker(t_hurst_cli_round* round);
+long sc_hurst_cli_process(t_hurst_cli_opts* opts, const double* view, long view_base, long view_length, long* next_end, t_hurst_result* results, FILE* out); //evaluates and writes every window ending within the view, returns the number written
+double sc_hurst_cli_seconds(void);
+
+int main(int argc, char** argv) {
+    t_hurst_cli_opts opts;
+    if(sc_hurst_cli_parse(&opts, argc, argv) != 0) {
+        sc_hurst_cli_usage();
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if(opts.output != NULL) {
+        out = fopen(opts.output, "w");
+        if(out == NULL) {
+            fprintf(stderr, "sc.hurst.cli: can't open %s for writing\n", opts.output);
+            return 1;
+        }
+    }
+
+    t_hurst_cli_reader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.format = opts.format;
+
+    //raw files are mapped rather than read, everything else goes through a stream
+    int fd = -1;
+    if(opts.input != NULL && strcmp(opts.format, "csv") != 0) {
+        struct stat st;
+        fd = open(opts.input, O_RDONLY);
+        if(fd < 0 || fstat(fd, &st) != 0) {
+            fprintf(stderr, "sc.hurst.cli: can't open %s\n", opts.input);
+            return 1;
+        }
+        reader.mapped_size = (size_t)st.st_size;
+        if(reader.mapped_size > 0) {
+            void* mapped = mmap(NULL, reader.mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapped == MAP_FAILED) {
+                fprintf(stderr, "sc.hurst.cli: can't map %s\n", opts.input);
+                return 1;
+            }
+            madvise(mapped, reader.mapped_size, MADV_SEQUENTIAL);
+            reader.mapped = (const unsigned char*)mapped;
+        } else {
+            //nothing to map (an empty file, or a pipe or device that reports no size), so it's read as a stream
+            close(fd);
+            fd = -1;
+            reader.stream = fopen(opts.input, "rb");
+            if(reader.stream == NULL) {
+                fprintf(stderr, "sc.hurst.cli: can't open %s\n", opts.input);
+                return 1;
+            }
+        }
+    } else if(opts.input != NULL) {
+        reader.stream = fopen(opts.input, "r");
+        if(reader.stream == NULL) {
+            fprintf(stderr, "sc.hurst.cli: can't open %s\n", opts.input);
+            return 1;
+        }
+    } else {
+        reader.stream = stdin;
+    }
+
+    t_hurst_result* results = (t_hurst_result*)malloc(sizeof(t_hurst_result) * SC_HURST_CLI_ROUND);
+    long next_end = opts.hop; //end (exclusive) of the next window to evaluate
+    long total = 0;
+    long written = 0;
+    double start = sc_hurst_cli_seconds();
+
+    if(reader.mapped != NULL && strcmp(opts.format, "f64") == 0) {
+        //a mapped f64 file already is the series, so windows are evaluated in place
+        total = (long)(reader.mapped_size / sizeof(double));
+        written = sc_hurst_cli_process(&opts, (const double*)reader.mapped, 0, total, &next_end, results, out);
+    } else {
+        //keep the last max_length samples in view while reading the next chunk behind them
+        double* buf = (double*)malloc(sizeof(double) * (opts.max_length + SC_HURST_CLI_CHUNK));
+        long buf_base = 0;
+        long buf_length = 0;
+        long count;
+
+        if(reader.stream != NULL && strcmp(opts.format, "csv") == 0) {
+            reader.text = (char*)malloc(SC_HURST_CLI_TEXT);
+        }
+
+        while((count = sc_hurst_cli_read(&reader, buf + buf_length, SC_HURST_CLI_CHUNK)) > 0) {
+            buf_length += count;
+            total += count;
+            written += sc_hurst_cli_process(&opts, buf, buf_base, buf_length, &next_end, results, out);
+
+            if(buf_length > opts.max_length) {
+                long drop = buf_length - opts.max_length;
+                memmove(buf, buf + drop, sizeof(double) * opts.max_length);
+                buf_base += drop;
+                buf_length = opts.max_length;
+            }
+        }
+
+        if(reader.skipped > 0) {
+            fprintf(stderr, "sc.hurst.cli: skipped %ld non-numeric values\n", reader.skipped);
+        }
+        if(reader.text != NULL) {
+            free(reader.text);
+        }
+        free(buf);
+    }
+
+    double elapsed = sc_hurst_cli_seconds() - start;
+    double bytes = (double)total * ((strcmp(opts.format, "f32") == 0) ? sizeof(float) : sizeof(double));
+    fprintf(stderr, "sc.hurst.cli: %ld samples, %ld estimates in %.3f s (%.2f Msamples/s, %.1f MB/s, %ld threads)\n",
+            total, written, elapsed,
+            (elapsed > 0) ? (total / elapsed) / 1000000 : 0,
+            (elapsed > 0) ? (bytes / elapsed) / 1000000 : 0,
+            opts.thread_count);
+
+    free(results);
+    if(reader.mapped != NULL) {
+        munmap((void*)reader.mapped, reader.mapped_size);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+    if(reader.stream != NULL && reader.stream != stdin) {
+        fclose(reader.stream);
+    }
+    if(out != stdout) {
+        fclose(out);
+    }
+
+    return 0;
+}
+
+/*==================================================================================
+ ========================OPTIONS=========================================
+ ====================================================================================*/
+
+void sc_hurst_cli_usage(void) {
+    fprintf(stderr,
+            "usage: sc.hurst.cli [options] [input]\n"
+            "  reads input (or stdin) and writes one hurst estimate per window\n"
+            "  -f, --format f64|f32|csv  raw little-endian doubles, raw floats or text (default f64, csv for stdin)\n"
+            "  -l, --max-length N        window length (default 256)\n"
+            "  -p, --hop N               samples between estimates (default 1)\n"
+            "  -m, --max-blocks N        approx mode block budget per layer, 0 evaluates every block (default 0)\n"
+            "  -q, --qlist q1,q2,...     also write the generalized exponents h(q) after each estimate\n"
+            "  -e, --estimator rs|wavelet|spectral  rescaled range, haar wavelet variance or periodogram slope (default rs)\n"
+            "  -t, --threads N           threads evaluating windows (default: number of cores)\n"
+            "  -o, --output FILE         write estimates to FILE instead of stdout\n");
+}
+
+int sc_hurst_cli_parse(t_hurst_cli_opts* opts, int argc, char** argv) {
+    opts->input = NULL;
+    opts->output = NULL;
+    opts->format = NULL;
+    opts->max_length = 256;
+    opts->hop = 1;
+    opts->max_blocks = 0;
+    opts->qlist_count = 0;
+    opts->estimator = SC_HURST_RS;
+    opts->thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for(int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(arg[0] != '-') {
+            opts->input = arg;
+            continue;
+        }
+        if(val == NULL) {
+            fprintf(stderr, "sc.hurst.cli: %s needs a value\n", arg);
+            return 1;
+        }
+        i++;
+
+        if(strcmp(arg, "-f") == 0 || strcmp(arg, "--format") == 0) {
+            opts->format = val;
+        } else if(strcmp(arg, "-l") == 0 || strcmp(arg, "--max-length") == 0) {
+            opts->max_length = atol(val);
+        } else if(strcmp(arg, "-p") == 0 || strcmp(arg, "--hop") == 0) {
+            opts->hop = atol(val);
+        } else if(strcmp(arg, "-m") == 0 || strcmp(arg, "--max-blocks") == 0) {
+            opts->max_blocks = atol(val);
+        } else if(strcmp(arg, "-e") == 0 || strcmp(arg, "--estimator") == 0) {
+            if(strcmp(val, "rs") == 0) {
+                opts->estimator = SC_HURST_RS;
+            } else if(strcmp(val, "wavelet") == 0) {
+                opts->estimator = SC_HURST_WAVELET;
+            } else if(strcmp(val, "spectral") == 0) {
+                opts->estimator = SC_HURST_SPECTRAL;
+            } else {
+                fprintf(stderr, "sc.hurst.cli: bad estimator %s. Expected rs, wavelet or spectral\n", val);
+                return 1;
+            }
+        } else if(strcmp(arg, "-t") == 0 || strcmp(arg, "--threads") == 0) {
+            opts->thread_count = atol(val);
+        } else if(strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) {
+            opts->output = val;
+        } else if(strcmp(arg, "-q") == 0 || strcmp(arg, "--qlist") == 0) {
+            const char* q = val;
+            char* q_end;
+            while(*q != '\0') {
+                if(opts->qlist_count == SC_HURST_MAX_Q) {
+                    fprintf(stderr, "sc.hurst.cli: at most %d values in qlist\n", SC_HURST_MAX_Q);
+                    return 1;
+                }
+                opts->qlist[opts->qlist_count] = strtod(q, &q_end);
+                if(q_end == q) {
+                    fprintf(stderr, "sc.hurst.cli: bad value in qlist: %s\n", val);
+                    return 1;
+                }
+                opts->qlist_count++;
+                q = (*q_end == ',') ? q_end + 1 : q_end;
+            }
+        } else {
+            fprintf(stderr, "sc.hurst.cli: unknown option %s\n", arg);
+            return 1;
+        }
+    }
+
+    if(opts->format == NULL) {
+        opts->format = (opts->input != NULL) ? "f64" : "csv";
+    }
+    if(strcmp(opts->format, "f64") != 0 && strcmp(opts->format, "f32") != 0 && strcmp(opts->format, "csv") != 0) {
+        fprintf(stderr, "sc.hurst.cli: bad format %s. Expected f64, f32 or csv\n", opts->format);
+        return 1;
+    }
+    //same limits as the external's attributes
+    if(opts->max_length <= 16) {
+        fprintf(stderr, "sc.hurst.cli: bad value for max-length. Expected a positive integer > 16\n");
+        return 1;
+    }
+    if(opts->hop < 1) {
+        fprintf(stderr, "sc.hurst.cli: bad value for hop. Expected a positive integer\n");
+        return 1;
+    }
+    if(opts->max_blocks != 0 && opts->max_blocks < 2) {
+        fprintf(stderr, "sc.hurst.cli: bad value for max-blocks. Expected 0 or a positive integer >= 2\n");
+        return 1;
+    }
+    if(opts->thread_count < 1) {
+        opts->thread_count = 1;
+    }
+
+    return 0;
+}
+
+/*==================================================================================
+ ========================INPUT=========================================
+ ====================================================================================*/
+
+long sc_hurst_cli_read(t_hurst_cli_reader* r, double* dst, long max_count) {
+    if(strcmp(r->format, "csv") == 0) {
+        return sc_hurst_cli_read_text(r, dst, max_count);
+    }
+
+    long count = 0;
+    int is_f32 = (strcmp(r->format, "f32") == 0);
+    size_t width = is_f32 ? sizeof(float) : sizeof(double);
+
+    if(r->mapped != NULL) {
+        size_t available = (r->mapped_size - r->position) / width;
+        count = ((size_t)max_count < available) ? max_count : (long)available;
+        const unsigned char* src = r->mapped + r->position;
+        if(is_f32) {
+            const float* f = (const float*)src;
+            for(long i = 0; i < count; i++) {
+                dst[i] = f[i];
+            }
+        } else {
+            memcpy(dst, src, count * width);
+        }
+        r->position += count * width;
+        return count;
+    }
+
+    if(is_f32) {
+        //read the floats into the back half of dst and widen them forwards, which never overwrites one not yet read
+        float* f = (float*)(dst + max_count) - max_count;
+        count = (long)fread(f, sizeof(float), max_count, r->stream);
+        for(long i = 0; i < count; i++) {
+            dst[i] = f[i];
+        }
+        return count;
+    }
+
+    return (long)fread(dst, sizeof(double), max_count, r->stream);
+}
+
+long sc_hurst_cli_read_text(t_hurst_cli_reader* r, double* dst, long max_count) {
+    long count = 0;
+
+    while(count < max_count) {
+        //skip separators
+        while(r->text_pos < r->text_length && strchr(" \t\r\n,;", r->text[r->text_pos]) != NULL) {
+            r->text_pos++;
+        }
+
+        //find the end of the token, a token running into the end of the buffer may continue in the next read
+        long end = r->text_pos;
+        while(end < r->text_length && strchr(" \t\r\n,;", r->text[end]) == NULL) {
+            end++;
+        }
+
+        if(end == r->text_length && !r->eof) {
+            long keep = r->text_length - r->text_pos;
+            if(keep == SC_HURST_CLI_TEXT - 1) {
+                keep = 0; //a single token filling the whole buffer isn't a number, drop it
+                r->skipped++;
+            }
+            memmove(r->text, r->text + r->text_pos, keep);
+            r->text_length = keep;
+            r->text_pos = 0;
+
+            size_t n = fread(r->text + r->text_length, 1, SC_HURST_CLI_TEXT - 1 - r->text_length, r->stream);
+            if(n == 0) {
+                r->eof = 1;
+            }
+            r->text_length += n;
+            continue;
+        }
+
+        if(end == r->text_pos) {
+            break; //nothing left
+        }
+
+        char saved = r->text[end];
+        char* parsed;
+        r->text[end] = '\0';
+        double value = strtod(r->text + r->text_pos, &parsed);
+        if(parsed == r->text + end) {
+            dst[count] = value;
+            count++;
+        } else {
+            r->skipped++; //headers and other text
+        }
+        r->text[end] = saved;
+        r->text_pos = end;
+    }
+
+    return count;
+}
+
+/*==================================================================================
+ ========================WINDOWS=========================================
+ ====================================================================================*/
+
+long sc_hurst_cli_process(t_hurst_cli_opts* opts, const double* view, long view_base, long view_length, long* next_end, t_hurst_result* results, FILE* out) {
+    long written = 0;
+
+    while(*next_end <= view_base + view_length) {
+        t_hurst_cli_round round;
+        round.opts = opts;
+        round.view = view;
+        round.view_base = view_base;
+        round.first_end = *next_end;
+        round.window_count = ((view_base + view_length - *next_end) / opts->hop) + 1;
+        if(round.window_count > SC_HURST_CLI_ROUND) {
+            round.window_count = SC_HURST_CLI_ROUND;
+        }
+        round.next = 0;
+        round.results = results;
+        pthread_mutex_init(&round.lock, NULL);
+
+        sc_hurst_cli_run_round(&round);
+
+        pthread_mutex_destroy(&round.lock);
+
+        //write in window order, skipping windows that were too short (the external warns and outputs nothing)
+        for(long w = 0; w < round.window_count; w++) {
+            t_hurst_result* result = results + w;
+            if(result->layer_count == 0) {
+                continue;
+            }
+            fprintf(out, "%.6f", result->hurst);
+            for(long m = 0; m < result->hq_count; m++) {
+                fprintf(out, " %.6f", result->hq[m]);
+            }
+            fputc('\n', out);
+            written++;
+        }
+
+        *next_end += round.window_count * opts->hop;
+    }
+
+    return written;
+}
+
+void sc_hurst_cli_run_round(t_hurst_cli_round* round) {
+    long helper_count = round->opts->thread_count - 1;
+    pthread_t* helpers = NULL;
+
+    //no point starting more threads than there are grains of work
+    long grains = (round->window_count + SC_HURST_CLI_GRAIN - 1) / SC_HURST_CLI_GRAIN;
+    if(helper_count > grains - 1) {
+        helper_count = grains - 1;
+    }
+
+    if(helper_count > 0) {
+        helpers = (pthread_t*)malloc(sizeof(pthread_t) * helper_count);
+        for(long i = 0; i < helper_count; i++) {
+            pthread_create(helpers + i, NULL, (void* (*)(void*))sc_hurst_cli_worker, round);
+        }
+    }
+
+    sc_hurst_cli_worker(round);
+
+    for(long i = 0; i < helper_count; i++) {
+        pthread_join(helpers[i], NULL);
+    }
+    if(helpers != NULL) {
+        free(helpers);
+    }
+}
+
+void* sc_hurst_cli_worker(t_hurst_cli_round* round) {
+    t_hurst_cli_opts* opts = round->opts;
+
+    while(1) {
+        pthread_mutex_lock(&round->lock);
+        long w0 = round->next;
+        round->next += SC_HURST_CLI_GRAIN;
+        pthread_mutex_unlock(&round->lock);
+
+        if(w0 >= round->window_count) {
+            break;
+        }
+        long w1 = (w0 + SC_HURST_CLI_GRAIN < round->window_count) ? w0 + SC_HURST_CLI_GRAIN : round->window_count;
+
+        for(long w = w0; w < w1; w++) {
+            //the same window the external would hold after receiving every sample up to end
+            long end = round->first_end + (w * opts->hop);
+            long start = (end > opts->max_length) ? end - opts->max_length : 0;
+            t_hurst_result* result = round->results + w;
+
+            if(end - start < 16) {
+                result->layer_count = 0;
+                result->hq_count = 0;
+                continue;
+            }
+
+            t_hurst_calc* calc = sc_hurst_calc_new(NULL, (double*)round->view + (start - round->view_base), end - start, opts->max_blocks, opts->qlist, opts->qlist_count, NULL, opts->estimator);
+            sc_hurst_calc_step(calc, 0, NULL);
+            sc_hurst_calc_result(calc, result);
+            sc_hurst_calc_free(calc);
+        }
+    }
+
+    return NULL;
+}
+
+double sc_hurst_cli_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+#ifdef DEBUG
+void sc_hurst_debug_post(void* owner, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+#endif
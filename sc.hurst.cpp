@@ -8,9 +8,15 @@
 #include "ext.h"                            // standard Max include, always required
 #include "ext_obex.h"                       // required for new style Max object
 #include "ext_critical.h"                   // for using critical regions
+#include "ext_systime.h"                    // for timing the benchmark
+#include "ext_systhread.h"                  // for the shared batch thread pool
 #include <math.h>                           // for log calculations
-
-//#define DEBUG
+#include <stdarg.h>                         // for forwarding debug posts from the calculation
+#include <string.h>                         // for checking a copied span is still current
+#ifndef WIN_VERSION
+#include <unistd.h>                         // for counting processors
+#endif
+#include "sc.hurst.calc.h"                  // calculation shared with sc.hurst.cli
 
 //=====================OBJECT STRUCT==================
 typedef struct _sc_hurst
@@ -21,8 +27,37 @@ typedef struct _sc_hurst
     long base_division_size;    //the size of the smallest data kernel
     long calc_on_input;
     long show_size_warning;
-    //long thread_count;
-    double* data_set;
+    long approx;                //when on, only a stratified subset of each layer's blocks is evaluated
+    long max_blocks_per_layer;  //block budget per layer used when approx is on
+    double budget_us;           //time budget of a calculation when approx is on, layers not finished by then are left out (0 for none)
+    long progressive;           //when on, calculations run in time-sliced steps driven by prog_clock
+    double slice_ms;            //time budget of a single progressive slice
+    t_symbol* arrival_policy;   //"restart" or "defer", what happens to data received during a progressive calculation
+    void* prog_clock;           //clock that runs the next progressive slice
+    t_hurst_calc* prog_calc;    //progressive calculation in flight (NULL when idle), it runs on its own copy of the data set
+    t_hurst_calc* prog_stepping; //calculation a tick is stepping outside the critical region, that tick frees it if it's stopped meanwhile
+    long prog_generation;       //incremented whenever prog_calc is replaced, tells a tick its calculation was stopped under it
+    double* deferred;           //data held back under the defer policy (prog_ and deferred members are guarded by the critical region)
+    long deferred_length;
+    long deferred_capacity;
+    long batch;                 //when on, calculations are handed to the shared engine and run with every other instance's
+    long batch_pending;         //1 while waiting in the engine's pending list
+    long thread_count;          //mirrors the engine's thread count, which is shared by every instance
+    double qlist[SC_HURST_MAX_Q]; //moments of the generalized hurst exponents h(q), empty for none
+    long qlist_count;
+    long windows[SC_HURST_MAX_WINDOWS]; //horizons evaluated together from the one data set, empty for a single estimate
+    long windows_count;
+    t_symbol* estimator;        //"rs", "wavelet" or "spectral"
+    t_hurst_sdft* sdft;         //low frequency bins slid along with each new value for the spectral estimator (NULL until first needed)
+    long horizon;               //samples of history kept as aggregates beyond the window (0 for none)
+    t_hurst_pyramid* pyramid;   //history of samples that have left the window, NULL when horizon is 0
+    long history_busy;          //1 while a thread is evaluating the pyramid's queued blocks outside the critical region
+    long history_generation;    //incremented whenever the pyramid is cleared or replaced, tells that thread its block is stale
+    double* data_set;           //live window, always data_base + data_head
+    void* data_block;           //the one allocation behind data_set, as returned by sysmem_newptr
+    double* data_base;          //data_block rounded up to a 64 byte boundary
+    long data_capacity;         //values data_base has room for
+    long data_head;             //offset of the oldest value from data_base, advanced instead of shifting the data
     //t_systhread* threads; //pointer to thread array
 #ifdef DEBUG
     long debug;
@@ -32,37 +67,52 @@ typedef struct _sc_hurst
 } t_sc_hurst;
 
 
-//===================HELPER STRUCTS====================
-
-//sent to the helper thread for calculating the mean and standard deviation
-typedef struct _sc_hurst_helper_in
-{
-    double* src_data;
-    long idx0;
-    long idx1;
-    double mean; //filled in by thread (should start as 0)
-    double stddev; //filled in by thread (should start as 0)
-} t_hurst_helper_ms;
-
-//sent to the helper thread for calculating the range
-typedef struct _sc_hurst_helper_range
+//one instance's calculation within a batch
+typedef struct _sc_hurst_job
 {
-    double* src_data;
-    long idx0;
-    long idx1;
-    double mean;
-    double range; //filled in by thread (should start as 0)
-} t_hurst_helper_rs;
-
-//sent to linear regression helper function (should be passed as mutable to allow the slope member to be set in the function)
-typedef struct _sc_hurst_helper_lin_reg
+    t_sc_hurst* owner; //instance the result goes back to (NULL if it was freed during the batch)
+    double* data; //snapshot of the owner's data set, taken when the batch starts
+    long length; //length of data
+    long capacity; //allocated length of data, kept between batches
+    long approx; //approx setting of the owner when the snapshot was taken
+    long max_blocks; //block budget for the calculation (0 evaluates every block)
+    double budget_ms; //time budget for the calculation (0 for none)
+    double qlist[SC_HURST_MAX_Q]; //owner's qlist when the snapshot was taken
+    long qlist_count;
+    long estimator; //owner's estimator when the snapshot was taken
+    long has_history; //1 if the owner had a horizon when the snapshot was taken
+    t_hurst_history history; //owner's history totals when the snapshot was taken
+    t_hurst_result result; //filled in by whichever thread runs the job
+} t_hurst_job;
+
+//process wide engine that every instance registers with. Calculations requested during a scheduler tick are
+//collected and run together on the next one, spread over a pool of worker threads plus the scheduler thread
+typedef struct _sc_hurst_engine
 {
-    double* rs; //pointer to array of log2(R(n)/S(n))
-    double* size; //pointer to array of log2(block_size)
-    long rs_length; //length of rs array
-    long size_length; //length of block_size array
-    double slope; //slope of the best fit line, filled in by helper function
-} t_hurst_helper_lin_reg;
+    t_systhread_mutex lock; //guards every member below
+    t_systhread_cond wake; //signalled when a new batch is ready for the workers
+    t_systhread_cond done; //signalled when the last job of a batch finishes
+    void* clock; //runs the pending batch on the next scheduler tick
+    long registered; //number of live instances
+    t_sc_hurst** pending; //instances waiting for the next batch
+    long pending_count;
+    long pending_capacity;
+    t_hurst_job* jobs; //jobs of the current batch
+    long job_count;
+    long job_capacity;
+    long* range_begin; //next job each participant takes from the front of its range (participant 0 is the scheduler thread)
+    long* range_end; //end of each participant's range, other participants steal from here
+    long remaining; //jobs of the current batch that have not finished
+    long generation; //incremented with every batch, workers sleep until it changes
+    long running; //1 from the moment a tick takes the pending list until its results are written back
+    t_sc_hurst* writing; //instance whose result is going out its outlets right now (NULL between write backs)
+    t_systhread writer; //thread doing that write back
+    long thread_count; //requested number of threads, including the scheduler thread
+    t_systhread* workers; //worker threads (thread_count - 1 of them once started)
+    long* worker_index; //participant index handed to each worker thread
+    long worker_count;
+    long quit; //tells the workers to exit
+} t_hurst_engine;
 
 //===================FUNTCTION PROTOTYPES==============
 
@@ -75,6 +125,10 @@ void sc_hurst_bang(t_sc_hurst *x);
 void sc_hurst_int(t_sc_hurst *x, long n);
 void sc_hurst_float(t_sc_hurst *x, double f);
 void sc_hurst_list(t_sc_hurst *x, t_symbol* a, long argc, t_atom *argv);
+void sc_hurst_append(t_sc_hurst *x, double* data_list, long data_size); //adds values to the data set, dropping the oldest values if needed, call inside the critical region
+void sc_hurst_drop(t_sc_hurst *x, long count); //drops the oldest values by advancing the head, compacting only once the end of the buffer is reached
+void sc_hurst_reserve(t_sc_hurst *x, long capacity); //moves the live data into a new aligned buffer of the given capacity
+long sc_hurst_slack(long max_length); //room kept past max_length for the head to advance into before the data is compacted
 
 //Attribute Mutators
 void sc_hurst_set_max_length(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
@@ -82,7 +136,18 @@ void sc_hurst_set_length(t_sc_hurst *x, void *attr, long argc, t_atom *argv); //
 void sc_hurst_set_div_size(t_sc_hurst *x, void *attr, long argc, t_atom *argv); //not exposed for now
 void sc_hurst_set_coi(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
 void sc_hurst_set_size_warning(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
-void sc_hurst_set_thread_count(t_sc_hurst *x, void *attr, long argc, t_atom *argv); //not exposed for now
+void sc_hurst_set_approx(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_max_blocks(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_budget(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_progressive(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_slice_ms(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_arrival_policy(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_thread_count(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_batch(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_qlist(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_horizon(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_estimator(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
+void sc_hurst_set_windows(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
 
 //Attribute Accessors
 void sc_hurst_get_max_length(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
@@ -90,7 +155,18 @@ void sc_hurst_get_length(t_sc_hurst *x, t_object *attr, long *argc, t_atom **arg
 void sc_hurst_get_div_size(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv); //not exposed for now
 void sc_hurst_get_coi(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
 void sc_hurst_get_size_warning(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
-void sc_hurst_get_thread_count(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv); //not exposed for now
+void sc_hurst_get_approx(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_max_blocks(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_budget(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_progressive(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_slice_ms(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_arrival_policy(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_thread_count(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_batch(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_qlist(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_horizon(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_estimator(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
+void sc_hurst_get_windows(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv);
 
 //assist function
 void sc_hurst_assist(t_sc_hurst *x, void *b, long m, long a, char *s);
@@ -102,14 +178,42 @@ t_max_err sc_hurst_notify(t_sc_hurst *x, t_symbol *s, t_symbol *msg, void *sende
 void sc_hurst_dump(t_sc_hurst *x); //dumps current data set out right outlet
 void sc_hurst_get_state(t_sc_hurst *x); //outputs current state of attributes out right outlet
 void sc_hurst_clear(t_sc_hurst *x); //clears internal data set
+void sc_hurst_bench(t_sc_hurst *x); //reports accuracy and latency of approx mode for each block budget out right outlet
+void sc_hurst_shrink(t_sc_hurst *x); //releases buffer capacity beyond what max_length needs
+void sc_hurst_memory(t_sc_hurst *x); //reports bytes reserved and bytes in use out right outlet
 
 //calculation
 void sc_hurst_calculate(t_sc_hurst *x); //calculates hurst exponent if possible
+void sc_hurst_compute(t_sc_hurst *x, long max_blocks, double budget_ms, t_hurst_result* result); //runs the calculation without output (max_blocks of 0 evaluates every block, budget_ms of 0 finishes every layer)
+void sc_hurst_output(t_sc_hurst *x, t_hurst_result* result, long show_error); //sends a result out the outlets
+t_hurst_history* sc_hurst_history(t_sc_hurst *x); //history totals to fold into a calculation, NULL when horizon is 0
+void sc_hurst_history_settle(t_sc_hurst *x); //evaluates the pyramid's filled staging blocks, call outside the critical region
+long sc_hurst_estimator(t_sc_hurst *x); //estimator attribute as the calculation's SC_HURST_ constant
+void sc_hurst_bank_output(t_sc_hurst *x); //calculates every horizon in windows and sends them out as one list
+void sc_hurst_spectrum(t_sc_hurst *x, t_hurst_calc* calc); //hands a spectral calculation the sliding DFT's bins, syncing them first if needed
+void sc_hurst_slide(t_sc_hurst *x, double value); //moves the sliding DFT along by one value, must be called before the value is added to a full data set
+
+//progressive calculation
+void sc_hurst_progress_start(t_sc_hurst *x); //(re)starts a progressive calculation over the current data set
+void sc_hurst_progress_tick(t_sc_hurst *x); //runs one slice, called from prog_clock
+void sc_hurst_progress_stop(t_sc_hurst *x); //abandons the calculation in flight
+long sc_hurst_progress_defer(t_sc_hurst *x, double* values, long count); //holds values back if the defer policy applies, returns 1 if it did
+void sc_hurst_progress_flush(t_sc_hurst *x); //adds deferred values to the data set
+void sc_hurst_progress_discard(t_sc_hurst *x); //drops prog_calc, call inside the critical region
+void sc_hurst_progress_release(t_hurst_calc* calc); //frees a progressive calculation along with its copy of the data set
 
-//helper functions for calculations (will only be called by helper threads)
-void sc_hurst_stddev_and_mean_helper(t_hurst_helper_ms** x, t_sc_hurst* t); //calculating mean and standard deviation. (requires mutable struct pointer)
-void sc_hurst_helper_range(t_hurst_helper_rs** x); //calculating the rescaled range (requires mutable struct pointer)
-void sc_hurst_helper_linear_regression(t_hurst_helper_lin_reg** x); //helper function to calculate linear regression of each block size
+//shared batch engine
+void sc_hurst_engine_init(void); //sets up the engine's locks and clock, called once from ext_main
+void sc_hurst_engine_register(t_sc_hurst *x);
+void sc_hurst_engine_unregister(t_sc_hurst *x); //removes x from any pending or running batch
+void sc_hurst_engine_request(t_sc_hurst *x); //queues a calculation for the next batch
+void sc_hurst_engine_tick(t_hurst_engine* e); //runs every pending calculation as one batch, called from the engine clock
+void sc_hurst_engine_work(t_hurst_engine* e, long participant); //runs jobs until none are left to take or steal
+void* sc_hurst_engine_worker(long* participant); //worker thread loop
+void sc_hurst_engine_start_workers(t_hurst_engine* e); //must only be called while no batch is running
+void sc_hurst_engine_stop_workers(t_hurst_engine* e); //must only be called while no batch is running
+void sc_hurst_engine_free_jobs(t_hurst_engine* e); //releases the snapshot buffers kept between batches
+long sc_hurst_engine_cpu_count(void); //processors available, the default thread count
 
 #ifdef DEBUG
 void sc_hurst_set_debug(t_sc_hurst *x, void *attr, long argc, t_atom *argv);
@@ -119,6 +223,9 @@ void sc_hurst_get_debug(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv
 //======================CLASS POINTER VARIABLE============
 void *sc_hurst_class;
 
+//======================SHARED ENGINE=====================
+t_hurst_engine sc_hurst_engine;
+
 void ext_main(void *r) {
     t_class *c;
     
@@ -132,6 +239,9 @@ void ext_main(void *r) {
     class_addmethod(c, (method)sc_hurst_clear,      "clear",            0);
     class_addmethod(c, (method)sc_hurst_get_state,  "getstate",         0);
     class_addmethod(c, (method)sc_hurst_list,       "list",     A_GIMME, 0);
+    class_addmethod(c, (method)sc_hurst_bench,      "bench",            0);
+    class_addmethod(c, (method)sc_hurst_shrink,     "shrink",           0);
+    class_addmethod(c, (method)sc_hurst_memory,     "memory",           0);
     
     //add attributes
     CLASS_ATTR_LONG(c, "max_length", 0, t_sc_hurst, series_max_length);
@@ -148,6 +258,47 @@ void ext_main(void *r) {
     CLASS_ATTR_STYLE(c, "size_warning", 0, "onoff");
     CLASS_ATTR_ACCESSORS(c, "size_warning", sc_hurst_get_size_warning, sc_hurst_set_size_warning);
     
+    CLASS_ATTR_LONG(c, "approx", 0, t_sc_hurst, approx);
+    CLASS_ATTR_STYLE(c, "approx", 0, "onoff");
+    CLASS_ATTR_ACCESSORS(c, "approx", sc_hurst_get_approx, sc_hurst_set_approx);
+    
+    CLASS_ATTR_LONG(c, "max_blocks_per_layer", 0, t_sc_hurst, max_blocks_per_layer);
+    CLASS_ATTR_ACCESSORS(c, "max_blocks_per_layer", sc_hurst_get_max_blocks, sc_hurst_set_max_blocks);
+    
+    CLASS_ATTR_DOUBLE(c, "budget_us", 0, t_sc_hurst, budget_us);
+    CLASS_ATTR_ACCESSORS(c, "budget_us", sc_hurst_get_budget, sc_hurst_set_budget);
+    
+    CLASS_ATTR_LONG(c, "progressive", 0, t_sc_hurst, progressive);
+    CLASS_ATTR_STYLE(c, "progressive", 0, "onoff");
+    CLASS_ATTR_ACCESSORS(c, "progressive", sc_hurst_get_progressive, sc_hurst_set_progressive);
+    
+    CLASS_ATTR_DOUBLE(c, "slice_ms", 0, t_sc_hurst, slice_ms);
+    CLASS_ATTR_ACCESSORS(c, "slice_ms", sc_hurst_get_slice_ms, sc_hurst_set_slice_ms);
+    
+    CLASS_ATTR_SYM(c, "arrival_policy", 0, t_sc_hurst, arrival_policy);
+    CLASS_ATTR_ENUM(c, "arrival_policy", 0, "restart defer");
+    CLASS_ATTR_ACCESSORS(c, "arrival_policy", sc_hurst_get_arrival_policy, sc_hurst_set_arrival_policy);
+    
+    CLASS_ATTR_LONG(c, "batch", 0, t_sc_hurst, batch);
+    CLASS_ATTR_STYLE(c, "batch", 0, "onoff");
+    CLASS_ATTR_ACCESSORS(c, "batch", sc_hurst_get_batch, sc_hurst_set_batch);
+    
+    CLASS_ATTR_LONG(c, "thread_count", 0, t_sc_hurst, thread_count);
+    CLASS_ATTR_ACCESSORS(c, "thread_count", sc_hurst_get_thread_count, sc_hurst_set_thread_count);
+    
+    CLASS_ATTR_DOUBLE_VARSIZE(c, "qlist", 0, t_sc_hurst, qlist, qlist_count, SC_HURST_MAX_Q);
+    CLASS_ATTR_ACCESSORS(c, "qlist", sc_hurst_get_qlist, sc_hurst_set_qlist);
+    
+    CLASS_ATTR_LONG_VARSIZE(c, "windows", 0, t_sc_hurst, windows, windows_count, SC_HURST_MAX_WINDOWS);
+    CLASS_ATTR_ACCESSORS(c, "windows", sc_hurst_get_windows, sc_hurst_set_windows);
+    
+    CLASS_ATTR_SYM(c, "estimator", 0, t_sc_hurst, estimator);
+    CLASS_ATTR_ENUM(c, "estimator", 0, "rs wavelet spectral");
+    CLASS_ATTR_ACCESSORS(c, "estimator", sc_hurst_get_estimator, sc_hurst_set_estimator);
+    
+    CLASS_ATTR_LONG(c, "horizon", 0, t_sc_hurst, horizon);
+    CLASS_ATTR_ACCESSORS(c, "horizon", sc_hurst_get_horizon, sc_hurst_set_horizon);
+    
 #ifdef DEBUG
     CLASS_ATTR_LONG(c, "debug", 0, t_sc_hurst, debug);
     CLASS_ATTR_STYLE(c, "debug", 0, "onoff");
@@ -164,6 +315,8 @@ void ext_main(void *r) {
     class_register(CLASS_BOX, c);
     
     sc_hurst_class = c;
+    
+    sc_hurst_engine_init();
 }
 
 //Assist function definition
@@ -189,10 +342,41 @@ void *sc_hurst_new(t_symbol *s, long argc, t_atom *argv) {
         x->base_division_size = 8;
         x->calc_on_input = 1;
         x->show_size_warning = 1;
+        x->approx = 0;
+        x->max_blocks_per_layer = 64;
+        x->budget_us = 0;
+        x->progressive = 0;
+        x->slice_ms = 2;
+        x->arrival_policy = gensym("restart");
+        x->prog_clock = clock_new(x, (method)sc_hurst_progress_tick);
+        x->prog_calc = NULL;
+        x->prog_stepping = NULL;
+        x->prog_generation = 0;
+        x->deferred = NULL;
+        x->deferred_length = 0;
+        x->deferred_capacity = 0;
+        x->batch = 0;
+        x->batch_pending = 0;
+        x->thread_count = sc_hurst_engine.thread_count;
+        x->qlist_count = 0;
+        x->windows_count = 0;
+        x->estimator = gensym("rs");
+        x->sdft = NULL;
+        x->horizon = 0;
+        x->pyramid = NULL;
+        x->history_busy = 0;
+        x->history_generation = 0;
         x->out = outlet_new(x, 0L);
         x->out2 = outlet_new(x, NULL);
         
-        x->data_set = (double*)sysmem_newptr(sizeof(double) * x->series_max_length);
+        x->data_set = NULL;
+        x->data_block = NULL;
+        x->data_base = NULL;
+        x->data_capacity = 0;
+        x->data_head = 0;
+        sc_hurst_reserve(x, x->series_max_length + sc_hurst_slack(x->series_max_length));
+        
+        sc_hurst_engine_register(x);
         
         attr_args_process(x, argc, argv);
     } else {
@@ -205,14 +389,35 @@ void *sc_hurst_new(t_symbol *s, long argc, t_atom *argv) {
 //Object destroy function
 void sc_hurst_free(t_sc_hurst *x) {
     
-    //for now, all we need to do is get rid of the data set pointers.
-    if(x->data_set != NULL) { //don't try to free non-existent data
-        double* temp = x->data_set;
-        for(int i = 0; (i < x->series_length || i < x->series_max_length); i++) {
-            double* t2 = temp;
-            temp++; //advance before we free the pointer we're referencing
-            sysmem_freeptr(t2);
-        }
+    sc_hurst_engine_unregister(x);
+    sc_hurst_progress_stop(x);
+    object_free(x->prog_clock);
+    
+    //a tick stepping on another thread still has to find out it was stopped, it frees the calculation itself.
+    //Likewise a thread evaluating history blocks has to finish before the pyramid goes
+    critical_enter(0);
+    while(x->prog_stepping != NULL || x->history_busy == 1) {
+        critical_exit(0);
+        systhread_sleep(1);
+        critical_enter(0);
+    }
+    critical_exit(0);
+
+    if(x->deferred != NULL) {
+        sysmem_freeptr(x->deferred);
+    }
+    if(x->pyramid != NULL) {
+        sc_hurst_pyramid_free(x->pyramid);
+    }
+    if(x->sdft != NULL) {
+        sc_hurst_sdft_free(x->sdft);
+    }
+    
+    //the whole data set is a single block
+    if(x->data_block != NULL) { //don't try to free non-existent data
+        sysmem_freeptr(x->data_block);
+        x->data_block = NULL;
+        x->data_set = NULL;
     }
 }
 
@@ -231,17 +436,22 @@ void sc_hurst_bang(t_sc_hurst *x){ //just attempt to calculate on bang
 }
 
 void sc_hurst_int(t_sc_hurst *x, long n){ //add data to the array
+    double value = (double)n;
+    if(sc_hurst_progress_defer(x, &value, 1)) {
+        return; //added once the running calculation finishes
+    }
 
     critical_enter(0); //block until done editing array
     if(x->series_length == x->series_max_length) {
-        double* temp = x->data_set; //temporary pointer to data set
-        double* temp2 = temp; //pointer to index 1 of set
-        temp2++;
+        if(x->pyramid != NULL) {
+            sc_hurst_pyramid_push(x->pyramid, x->data_set, 1); //the oldest value moves into the history
+        }
+        sc_hurst_slide(x, value);
+        sc_hurst_drop(x, 1); //advance past the oldest value rather than shifting everything left
         
-        sysmem_copyptr(temp2, temp, sizeof(double) * (x->series_max_length - 1)); //shift data 1 index to the left
-        //for(int i = 0; i < (x->series_max_length - 1); i++, temp++){} //move to the end of the array
-        temp += x->series_max_length - 1;
+        double* temp = x->data_set + x->series_length;
         *temp = (double)n; //fill last index with new data
+        x->series_length++;
         
     } else {
         double* temp = x->data_set + x->series_length; //get a temporary pointer to the data set
@@ -249,24 +459,33 @@ void sc_hurst_int(t_sc_hurst *x, long n){ //add data to the array
         *temp = (double)n; //add data
         x->series_length++;
     }
+    long restart = (x->prog_calc != NULL);
     critical_exit(0);
     
-    if(x->calc_on_input == 1) {
+    sc_hurst_history_settle(x);
+    
+    //a progressive calculation in flight is stale now, so restart it even without calc_on_input
+    if(x->calc_on_input == 1 || restart == 1) {
         sc_hurst_calculate(x);
     }
 }
 
 void sc_hurst_float(t_sc_hurst *x, double f) {
+    if(sc_hurst_progress_defer(x, &f, 1)) {
+        return; //added once the running calculation finishes
+    }
+    
     critical_enter(0); //block until done editing array
     if(x->series_length == x->series_max_length) {
-        double* temp = x->data_set; //temporary pointer to data set
-        double* temp2 = temp; //pointer to index 1 of set
-        temp2++;
+        if(x->pyramid != NULL) {
+            sc_hurst_pyramid_push(x->pyramid, x->data_set, 1); //the oldest value moves into the history
+        }
+        sc_hurst_slide(x, f);
+        sc_hurst_drop(x, 1); //advance past the oldest value rather than shifting everything left
         
-        sysmem_copyptr(temp2, temp, sizeof(double) * (x->series_max_length - 1)); //shift data 1 index to the left
-        //for(int i = 0; i < (x->series_max_length - 1); i++, temp++){} //move to the end of the array
-        temp += x->series_max_length - 1;
+        double* temp = x->data_set + x->series_length;
         *temp = f; //fill last index with new data
+        x->series_length++;
         
     } else {
         double* temp = x->data_set + x->series_length; //get a temporary pointer to the data set
@@ -274,9 +493,13 @@ void sc_hurst_float(t_sc_hurst *x, double f) {
         *temp = f; //add data
         x->series_length++;
     }
+    long restart = (x->prog_calc != NULL);
     critical_exit(0);
     
-    if(x->calc_on_input == 1) {
+    sc_hurst_history_settle(x);
+    
+    //a progressive calculation in flight is stale now, so restart it even without calc_on_input
+    if(x->calc_on_input == 1 || restart == 1) {
         sc_hurst_calculate(x);
     }
 }
@@ -299,7 +522,7 @@ void sc_hurst_list(t_sc_hurst *x, t_symbol* a, long argc, t_atom *argv) {
     int idx = 0;
     double* data_list;
     long data_size = argc;
-    if(argc > x->series_max_length) {
+    if(argc > x->series_max_length && x->pyramid == NULL) { //with a horizon the values that don't fit still belong in the history
         arg_temp += argc - x->series_max_length;
         idx = argc - x->series_max_length;
         data_size = x->series_max_length;
@@ -320,31 +543,91 @@ void sc_hurst_list(t_sc_hurst *x, t_symbol* a, long argc, t_atom *argv) {
         }
     }
     
+    long deferred = sc_hurst_progress_defer(x, data_list, data_size);
+    long restart = 0;
+    if(!deferred) {
+        //the batch engine copies the data set and history under the same lock
+        critical_enter(0);
+        sc_hurst_append(x, data_list, data_size);
+        restart = (x->prog_calc != NULL);
+        critical_exit(0);
+        
+        sc_hurst_history_settle(x);
+    }
+    
+    //free data
+    sysmem_freeptr(data_list);
+    
+    //restart policy: a progressive calculation in flight is stale now
+    if(restart == 1) {
+        sc_hurst_calculate(x);
+    }
+}
+
+void sc_hurst_append(t_sc_hurst *x, double* data_list, long data_size) {
+    //whole lists are cheaper to resync than to slide through
+    if(x->sdft != NULL) {
+        x->sdft->valid = 0;
+    }
+    
+    //more than a window's worth passes through in window sized pieces, so each value is evicted in order
+    while(data_size > x->series_max_length) {
+        sc_hurst_append(x, data_list, x->series_max_length);
+        data_list += x->series_max_length;
+        data_size -= x->series_max_length;
+    }
+    
     long tot_size = x->series_length + data_size;
     
     long del_idx = 0;
     
     if(tot_size > x->series_max_length) {
         del_idx = tot_size - x->series_max_length;
-        double* temp0 = x->data_set + del_idx;
-        double* temp1 = x->data_set;
-        sysmem_copyptr(temp0, temp1, sizeof(double) * (x->series_max_length - del_idx));
-        x->series_length = (x->series_length - del_idx > 0) ? (x->series_length - del_idx) : 0;
+        if(x->pyramid != NULL) {
+            sc_hurst_pyramid_push(x->pyramid, x->data_set, del_idx);
+        }
+        sc_hurst_drop(x, del_idx);
     }
     
     double* temp = x->data_set + x->series_length;
     
     sysmem_copyptr(data_list, temp, sizeof(double) * data_size);
     
-    //free data
-    data_temp = data_list;
-    for(int i = 0; i < data_size; i++) {
-        double* d2 = data_temp;
-        data_temp++;
-        sysmem_freeptr(d2);
+    x->series_length += data_size;
+}
+
+void sc_hurst_drop(t_sc_hurst *x, long count) {
+    x->data_head += count;
+    x->series_length -= count;
+    x->data_set = x->data_base + x->data_head;
+    
+    //with slack of at least max_length/8 this moves one window every slack values, at most 8 copies per value
+    if(x->data_head + x->series_max_length > x->data_capacity) {
+        sysmem_copyptr(x->data_set, x->data_base, sizeof(double) * x->series_length);
+        x->data_head = 0;
+        x->data_set = x->data_base;
     }
+}
+
+void sc_hurst_reserve(t_sc_hurst *x, long capacity) {
+    void* block = sysmem_newptr((sizeof(double) * capacity) + 63);
+    double* base = (double*)(((t_ptr_uint)block + 63) & ~((t_ptr_uint)63));
     
-    x->series_length += data_size;
+    if(x->data_block != NULL) {
+        sysmem_copyptr(x->data_set, base, sizeof(double) * x->series_length);
+        sysmem_freeptr(x->data_block);
+    }
+    
+    x->data_block = block;
+    x->data_base = base;
+    x->data_capacity = capacity;
+    x->data_head = 0;
+    x->data_set = base;
+}
+
+long sc_hurst_slack(long max_length) {
+    //an eighth of the window keeps compaction amortized O(1), the floor keeps small windows from compacting every few values
+    return (max_length / 8 > 1024) ? max_length / 8 : 1024;
 }
 
 /*==================================================================================
@@ -368,44 +651,54 @@ void sc_hurst_set_max_length(t_sc_hurst *x, void *attr, long argc, t_atom *argv)
                 break;
         }
         
+        if(x->horizon > 0 && temp_sl >= x->horizon) {
+            object_error((t_object *)x, "Bad value for max_length. Expected less than horizon (%ld)", x->horizon);
+            return;
+        }
+        
         if(temp_sl > 16) {
+            //the data set is about to move, so a progressive calculation can't continue on it
+            sc_hurst_progress_stop(x);
+            
+            //the batch engine copies the data set and history under the same lock
+            critical_enter(0);
             if(temp_sl < x->series_max_length) {
-                double* temp = (double*)sysmem_newptr(sizeof(double) * temp_sl);
-                double* t2 = x->data_set; //make sure to only copy the newest data
-                if(temp_sl < x->series_length) {
-                    t2 += x->series_length - temp_sl;
-                }
-                sysmem_copyptr(t2, temp, sizeof(double) * temp_sl);
-                
-                double* d1 = x->data_set; //create pointer to data we will free
-                x->data_set = temp; //point struct pointer to newly copied data
-                
-                //free pointers
-                for(int i = 0; i < x->series_max_length; i++) {
-                    double* d2 = d1;
-                    d1++;
-                    sysmem_freeptr(d2);
-                }
-                
+                //only the newest data is kept, dropping the rest just moves the head
                 x->series_max_length = temp_sl;
+                if(x->series_length > temp_sl) {
+                    if(x->pyramid != NULL) {
+                        sc_hurst_pyramid_push(x->pyramid, x->data_set, x->series_length - temp_sl);
+                    }
+                    sc_hurst_drop(x, x->series_length - temp_sl);
+                }
                 
             } else if(temp_sl > x->series_max_length) {
-                double* temp = (double*)sysmem_newptr(sizeof(double) * temp_sl); //allocate memory of the new size
-                sysmem_copyptr(x->data_set, temp, sizeof(double) * x->series_max_length); //copy existing data
-                double* d1 = x->data_set; //make pointer for freeing old data
-                x->data_set = temp; //struct pointer to new data
-                
-                //free pointers
-                for(int i = 0; i < x->series_max_length; i++) {
-                    double* d2 = d1;
-                    d1++;
-                    sysmem_freeptr(d2);
+                if(temp_sl + (sc_hurst_slack(temp_sl) / 2) > x->data_capacity) {
+                    //reallocating only once half the slack is used up means a run of small increases doesn't move the data each time
+                    sc_hurst_reserve(x, temp_sl + sc_hurst_slack(temp_sl));
+                } else if(x->data_head + temp_sl > x->data_capacity) {
+                    sysmem_copyptr(x->data_set, x->data_base, sizeof(double) * x->series_length);
+                    x->data_head = 0;
+                    x->data_set = x->data_base;
                 }
                 x->series_max_length = temp_sl;
                 
             } else {
                 //fail silently and do nothing
             }
+            
+            if(x->sdft != NULL) {
+                x->sdft->valid = 0;
+            }
+            
+            //the staging block follows the window size, the totals, pending and queued blocks and staged samples carry over
+            if(x->pyramid != NULL) {
+                sc_hurst_pyramid_resize(x->pyramid, x->series_max_length);
+            }
+            critical_exit(0);
+            
+            sc_hurst_progress_flush(x);
+            sc_hurst_history_settle(x);
         } else {
             object_error((t_object *)x, "Bad value for max_length. Expected a poisitve integer >= 16");
         }
@@ -423,9 +716,54 @@ void sc_hurst_set_div_size(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
      */
 }
 void sc_hurst_set_thread_count(t_sc_hurst *x, void *attr, long argc, t_atom *argv){
-    /*
-     One day I'll become a real boy
-     */
+    if(argc && argv) {
+        long temp_tc = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_tc = atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_tc = (long)atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for thread_count. Expected a positive integer");
+                return;
+                break;
+        }
+        
+        if(temp_tc < 1) {temp_tc = 1;}
+        if(temp_tc > 64) {temp_tc = 64;}
+        
+        //shared by every instance, the pool is resized at the start of the next batch
+        systhread_mutex_lock(sc_hurst_engine.lock);
+        sc_hurst_engine.thread_count = temp_tc;
+        systhread_mutex_unlock(sc_hurst_engine.lock);
+        x->thread_count = temp_tc;
+    }
+}
+
+void sc_hurst_set_batch(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        long temp_b = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_b = atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_b = (long)atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "bad value received for batch");
+                return;
+                break;
+        }
+        if(temp_b > 1) {temp_b = 1;}
+        if(temp_b < 0) {temp_b = 0;}
+        
+        x->batch = temp_b;
+    }
 }
 
 void sc_hurst_set_coi(t_sc_hurst *x, void *attr, long argc, t_atom *argv){
@@ -474,94 +812,459 @@ void sc_hurst_set_size_warning(t_sc_hurst *x, void *attr, long argc, t_atom *arg
     }
 }
 
-/*==================================================================================
- ========================ATTRIBUTE ACCESSORS=========================================
- ====================================================================================*/
-
-void sc_hurst_get_max_length(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
-    char alloc;
-    long sl = 0;
-    
-    atom_alloc(argc, argv, &alloc);
-    sl = x->series_max_length;
-    atom_setlong(*argv, sl);
-}
-
-void sc_hurst_get_length(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
-    char alloc;
-    long csize = 0;
-    
-    atom_alloc(argc, argv, &alloc);
-    csize = x->series_length;
-    atom_setlong(*argv, csize);
-}
-
-void sc_hurst_get_div_size(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
-    /*
-     One day I'll be a realy boy, for now I'm just a copy of the function above me.
-     */
-    char alloc;
-    long csize = 8;
-    
-    atom_alloc(argc, argv, &alloc);
-    //csize = x->series_length;
-    atom_setlong(*argv, csize);
+void sc_hurst_set_approx(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        long temp_a = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_a = atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_a = (long)atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "bad value received for approx");
+                return;
+                break;
+        }
+        if(temp_a > 1) {temp_a = 1;}
+        if(temp_a < 0) {temp_a = 0;}
+        
+        x->approx = temp_a;
+    }
 }
 
-void sc_hurst_get_coi(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
-    char alloc;
-    long coi = 0;
-    
-    atom_alloc(argc, argv, &alloc);
-    coi = x->calc_on_input;
-    atom_setlong(*argv, coi);
+void sc_hurst_set_max_blocks(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        long temp_mb = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_mb = atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_mb = (long)atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for max_blocks_per_layer. Expected a positive integer");
+                return;
+                break;
+        }
+        
+        if(temp_mb >= 2) {
+            x->max_blocks_per_layer = temp_mb;
+        } else {
+            object_error((t_object *)x, "Bad value for max_blocks_per_layer. Expected a positive integer >= 2");
+        }
+    }
 }
 
-void sc_hurst_get_size_warning(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
-    char alloc;
-    long sw = 0;
-    
-    atom_alloc(argc, argv, &alloc);
-    sw = x->show_size_warning;
-    atom_setlong(*argv, sw);
+void sc_hurst_set_budget(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        double temp_b = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_b = (double)atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_b = atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for budget_us. Expected 0 or a positive number");
+                return;
+                break;
+        }
+        
+        if(temp_b >= 0) {
+            x->budget_us = temp_b;
+        } else {
+            object_error((t_object *)x, "Bad value for budget_us. Expected 0 or a positive number");
+        }
+    }
 }
 
-void sc_hurst_get_thread_count(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
-    /*
-     One day I'll be a real boy, for now I'm just a copy of the function above me.
-     */
-    char alloc;
-    long sw = 1;
-    
-    atom_alloc(argc, argv, &alloc);
-    //sw = x->show_size_warning;
-    atom_setlong(*argv, sw);
+void sc_hurst_set_progressive(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        long temp_p = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_p = atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_p = (long)atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "bad value received for progressive");
+                return;
+                break;
+        }
+        if(temp_p > 1) {temp_p = 1;}
+        if(temp_p < 0) {temp_p = 0;}
+        
+        //turning progressive off abandons the calculation in flight
+        if(temp_p == 0) {
+            sc_hurst_progress_stop(x);
+            sc_hurst_progress_flush(x);
+            sc_hurst_history_settle(x);
+        }
+        
+        x->progressive = temp_p;
+    }
 }
 
-/*==================================================================================
- ========================GENERAL FUNCTIONS=========================================
- ====================================================================================*/
-
-void sc_hurst_dump(t_sc_hurst *x) {
-    critical_tryenter(0);
-    
-    if(x->series_length > 0){
-        double* d = x->data_set;
+void sc_hurst_set_slice_ms(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        double temp_ms = 0;
         
-        void* mem = sysmem_newptr(sizeof(t_atom) * (x->series_length + 1));
-        t_atom* list = (t_atom*)mem;
-        t_atom* temp_list = list;
-        atom_setsym(temp_list, gensym("values"));
-        temp_list++;
-        for(int i = 0; i < x->series_length; i++, d++, temp_list++) {
-            atom_setfloat(temp_list, *d);
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_ms = (double)atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_ms = atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for slice_ms. Expected a positive number");
+                return;
+                break;
         }
-        outlet_list((void*)x->out, gensym("values"), x->series_length, list);
         
-        sysmem_freeptr(mem);
+        if(temp_ms > 0) {
+            x->slice_ms = temp_ms;
+        } else {
+            object_error((t_object *)x, "Bad value for slice_ms. Expected a positive number");
+        }
+    }
+}
+
+void sc_hurst_set_arrival_policy(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        t_symbol* temp_ap = atom_getsym(argv);
         
+        if(atom_gettype(argv) == A_SYM && (temp_ap == gensym("restart") || temp_ap == gensym("defer"))) {
+            //values already deferred are kept until the running calculation finishes
+            x->arrival_policy = temp_ap;
+        } else {
+            object_error((t_object *)x, "Bad value for arrival_policy. Expected restart or defer");
+        }
     }
-    critical_exit(0);
+}
+
+void sc_hurst_set_qlist(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    //an empty list turns the generalized exponents off
+    if(argc > SC_HURST_MAX_Q) {
+        object_error((t_object *)x, "Too many values for qlist. Expected at most %ld", (long)SC_HURST_MAX_Q);
+        return;
+    }
+    
+    double temp_q[SC_HURST_MAX_Q];
+    t_atom* arg_temp = argv;
+    for(int i = 0; i < argc; i++, arg_temp++) {
+        switch(atom_gettype(arg_temp)) {
+            case A_LONG:
+                temp_q[i] = (double)atom_getlong(arg_temp);
+                break;
+            case A_FLOAT:
+                temp_q[i] = atom_getfloat(arg_temp);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for qlist. Expected a list of numbers");
+                return;
+                break;
+        }
+    }
+    
+    for(int i = 0; i < argc; i++) {
+        x->qlist[i] = temp_q[i];
+    }
+    x->qlist_count = argc;
+}
+
+void sc_hurst_set_windows(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    //an empty list goes back to a single estimate over the whole data set
+    if(argc > SC_HURST_MAX_WINDOWS) {
+        object_error((t_object *)x, "Too many values for windows. Expected at most %ld", (long)SC_HURST_MAX_WINDOWS);
+        return;
+    }
+    
+    long temp_w[SC_HURST_MAX_WINDOWS];
+    long largest = 0;
+    t_atom* arg_temp = argv;
+    for(int i = 0; i < argc; i++, arg_temp++) {
+        switch(atom_gettype(arg_temp)) {
+            case A_LONG:
+                temp_w[i] = atom_getlong(arg_temp);
+                break;
+            case A_FLOAT:
+                temp_w[i] = (long)atom_getfloat(arg_temp);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for windows. Expected a list of integers");
+                return;
+                break;
+        }
+        if(temp_w[i] <= 16) {
+            object_error((t_object *)x, "Bad value for windows. Expected integers > 16");
+            return;
+        }
+        largest = (temp_w[i] > largest) ? temp_w[i] : largest;
+    }
+    
+    //the data set has to hold the largest horizon
+    if(largest > x->series_max_length) {
+        t_atom ml;
+        atom_setlong(&ml, largest);
+        sc_hurst_set_max_length(x, NULL, 1, &ml);
+        if(x->series_max_length < largest) {
+            return; //max_length already reported why
+        }
+    }
+    
+    for(int i = 0; i < argc; i++) {
+        x->windows[i] = temp_w[i];
+    }
+    x->windows_count = argc;
+}
+
+void sc_hurst_set_estimator(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        t_symbol* temp_e = atom_getsym(argv);
+        
+        if(atom_gettype(argv) == A_SYM && (temp_e == gensym("rs") || temp_e == gensym("wavelet") || temp_e == gensym("spectral"))) {
+            //a calculation already in flight finishes with the estimator it started with
+            x->estimator = temp_e;
+            
+            //only the spectral estimator needs the sliding DFT kept up to date
+            critical_enter(0);
+            if(x->sdft != NULL && temp_e != gensym("spectral")) {
+                sc_hurst_sdft_free(x->sdft);
+                x->sdft = NULL;
+            }
+            critical_exit(0);
+        } else {
+            object_error((t_object *)x, "Bad value for estimator. Expected rs, wavelet or spectral");
+        }
+    }
+}
+
+void sc_hurst_set_horizon(t_sc_hurst *x, void *attr, long argc, t_atom *argv) {
+    if(argc && argv) {
+        long temp_h = 0;
+        
+        switch(atom_gettype(argv)) {
+            case A_LONG:
+                temp_h = atom_getlong(argv);
+                break;
+            case A_FLOAT:
+                temp_h = (long)atom_getfloat(argv);
+                break;
+            default:
+                object_error((t_object *)x, "Bad value for horizon. Expected 0 or a positive integer");
+                return;
+                break;
+        }
+        
+        if(temp_h != 0 && temp_h <= x->series_max_length) {
+            object_error((t_object *)x, "Bad value for horizon. Expected 0 or more than max_length (%ld)", x->series_max_length);
+            return;
+        }
+        
+        //a new horizon changes how fast the totals decay, so the history starts over
+        critical_enter(0);
+        if(x->pyramid != NULL) {
+            sc_hurst_pyramid_free(x->pyramid);
+            x->pyramid = NULL;
+        }
+        x->history_generation++;
+        if(temp_h > 0) {
+            x->pyramid = sc_hurst_pyramid_new(x->base_division_size, x->series_max_length, temp_h);
+        }
+        x->horizon = temp_h;
+        critical_exit(0);
+    }
+}
+
+/*==================================================================================
+ ========================ATTRIBUTE ACCESSORS=========================================
+ ====================================================================================*/
+
+void sc_hurst_get_windows(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    
+    atom_alloc_array(x->windows_count, argc, argv, &alloc);
+    for(int i = 0; i < x->windows_count; i++) {
+        atom_setlong(*argv + i, x->windows[i]);
+    }
+}
+
+void sc_hurst_get_estimator(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    
+    atom_alloc(argc, argv, &alloc);
+    atom_setsym(*argv, x->estimator);
+}
+
+void sc_hurst_get_horizon(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    
+    atom_alloc(argc, argv, &alloc);
+    atom_setlong(*argv, x->horizon);
+}
+
+void sc_hurst_get_max_length(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
+    char alloc;
+    long sl = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    sl = x->series_max_length;
+    atom_setlong(*argv, sl);
+}
+
+void sc_hurst_get_length(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
+    char alloc;
+    long csize = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    csize = x->series_length;
+    atom_setlong(*argv, csize);
+}
+
+void sc_hurst_get_div_size(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
+    /*
+     One day I'll be a realy boy, for now I'm just a copy of the function above me.
+     */
+    char alloc;
+    long csize = 8;
+    
+    atom_alloc(argc, argv, &alloc);
+    //csize = x->series_length;
+    atom_setlong(*argv, csize);
+}
+
+void sc_hurst_get_coi(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv){
+    char alloc;
+    long coi = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    coi = x->calc_on_input;
+    atom_setlong(*argv, coi);
+}
+
+void sc_hurst_get_size_warning(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    long sw = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    sw = x->show_size_warning;
+    atom_setlong(*argv, sw);
+}
+
+void sc_hurst_get_approx(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    long a = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    a = x->approx;
+    atom_setlong(*argv, a);
+}
+
+void sc_hurst_get_max_blocks(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    long mb = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    mb = x->max_blocks_per_layer;
+    atom_setlong(*argv, mb);
+}
+
+void sc_hurst_get_budget(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    double b = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    b = x->budget_us;
+    atom_setfloat(*argv, b);
+}
+
+void sc_hurst_get_progressive(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    long p = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    p = x->progressive;
+    atom_setlong(*argv, p);
+}
+
+void sc_hurst_get_slice_ms(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    double ms = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    ms = x->slice_ms;
+    atom_setfloat(*argv, ms);
+}
+
+void sc_hurst_get_arrival_policy(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    
+    atom_alloc(argc, argv, &alloc);
+    atom_setsym(*argv, x->arrival_policy);
+}
+
+void sc_hurst_get_thread_count(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    long tc = 1;
+    
+    atom_alloc(argc, argv, &alloc);
+    tc = sc_hurst_engine.thread_count;
+    atom_setlong(*argv, tc);
+}
+
+void sc_hurst_get_batch(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    long b = 0;
+    
+    atom_alloc(argc, argv, &alloc);
+    b = x->batch;
+    atom_setlong(*argv, b);
+}
+
+void sc_hurst_get_qlist(t_sc_hurst *x, t_object *attr, long *argc, t_atom **argv) {
+    char alloc;
+    
+    atom_alloc_array(x->qlist_count, argc, argv, &alloc);
+    for(int i = 0; i < x->qlist_count; i++) {
+        atom_setfloat(*argv + i, x->qlist[i]);
+    }
+}
+
+/*==================================================================================
+ ========================GENERAL FUNCTIONS=========================================
+ ====================================================================================*/
+
+void sc_hurst_dump(t_sc_hurst *x) {
+    critical_tryenter(0);
+    
+    if(x->series_length > 0){
+        double* d = x->data_set;
+        
+        void* mem = sysmem_newptr(sizeof(t_atom) * (x->series_length + 1));
+        t_atom* list = (t_atom*)mem;
+        t_atom* temp_list = list;
+        atom_setsym(temp_list, gensym("values"));
+        temp_list++;
+        for(int i = 0; i < x->series_length; i++, d++, temp_list++) {
+            atom_setfloat(temp_list, *d);
+        }
+        outlet_list((void*)x->out, gensym("values"), x->series_length, list);
+        
+        sysmem_freeptr(mem);
+        
+    }
+    critical_exit(0);
 }
 
 void sc_hurst_get_state(t_sc_hurst *x){
@@ -597,22 +1300,204 @@ void sc_hurst_get_state(t_sc_hurst *x){
     atom_setlong(temp_list, x->show_size_warning);
     outlet_list(x->out, gensym("size_warning"), 2, (t_atom*)state);
     
+    //approx mode
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("approx"));
+    temp_list++;
+    atom_setlong(temp_list, x->approx);
+    outlet_list(x->out, gensym("approx"), 2, (t_atom*)state);
+    
+    //block budget for approx mode
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("max_blocks_per_layer"));
+    temp_list++;
+    atom_setlong(temp_list, x->max_blocks_per_layer);
+    outlet_list(x->out, gensym("max_blocks_per_layer"), 2, (t_atom*)state);
+    
+    //time budget for approx mode
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("budget_us"));
+    temp_list++;
+    atom_setfloat(temp_list, x->budget_us);
+    outlet_list(x->out, gensym("budget_us"), 2, (t_atom*)state);
+    
+    //progressive mode
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("progressive"));
+    temp_list++;
+    atom_setlong(temp_list, x->progressive);
+    outlet_list(x->out, gensym("progressive"), 2, (t_atom*)state);
+    
+    //time budget of a progressive slice
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("slice_ms"));
+    temp_list++;
+    atom_setfloat(temp_list, x->slice_ms);
+    outlet_list(x->out, gensym("slice_ms"), 2, (t_atom*)state);
+    
+    //what happens to data arriving during a progressive calculation
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("arrival_policy"));
+    temp_list++;
+    atom_setsym(temp_list, x->arrival_policy);
+    outlet_list(x->out, gensym("arrival_policy"), 2, (t_atom*)state);
+    
+    //batching on the shared engine
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("batch"));
+    temp_list++;
+    atom_setlong(temp_list, x->batch);
+    outlet_list(x->out, gensym("batch"), 2, (t_atom*)state);
+    
+    //threads used by the shared engine
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("thread_count"));
+    temp_list++;
+    atom_setlong(temp_list, sc_hurst_engine.thread_count);
+    outlet_list(x->out, gensym("thread_count"), 2, (t_atom*)state);
+    
+    //estimator used by each calculation
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("estimator"));
+    temp_list++;
+    atom_setsym(temp_list, x->estimator);
+    outlet_list(x->out, gensym("estimator"), 2, (t_atom*)state);
+    
+    //history kept beyond the window
+    temp_list = (t_atom*)state;
+    atom_setsym(temp_list, gensym("horizon"));
+    temp_list++;
+    atom_setlong(temp_list, x->horizon);
+    outlet_list(x->out, gensym("horizon"), 2, (t_atom*)state);
+    
     temp_list = NULL;
     sysmem_freeptr(state);
     
+    //moments of the generalized exponents
+    t_atom* q_list = (t_atom*)sysmem_newptr(sizeof(t_atom) * (x->qlist_count + 1));
+    atom_setsym(q_list, gensym("qlist"));
+    for(int i = 0; i < x->qlist_count; i++) {
+        atom_setfloat(q_list + i + 1, x->qlist[i]);
+    }
+    outlet_list(x->out, gensym("qlist"), x->qlist_count + 1, q_list);
+    sysmem_freeptr(q_list);
+    
+    //horizons of the window bank
+    t_atom* w_list = (t_atom*)sysmem_newptr(sizeof(t_atom) * (x->windows_count + 1));
+    atom_setsym(w_list, gensym("windows"));
+    for(int i = 0; i < x->windows_count; i++) {
+        atom_setlong(w_list + i + 1, x->windows[i]);
+    }
+    outlet_list(x->out, gensym("windows"), x->windows_count + 1, w_list);
+    sysmem_freeptr(w_list);
+    
     sc_hurst_dump(x);
 }
 
-void sc_hurst_clear(t_sc_hurst *x){
-    critical_tryenter(0);
-    double* emptyd = (double*)sysmem_newptr(sizeof(double) * x->series_max_length);
-    sysmem_copyptr(emptyd, x->data_set, sizeof(double) * x->series_max_length);
-    for(int i = 0; i < x->series_max_length; i++) {
-        double* temp = emptyd;
-        emptyd++;
-        sysmem_freeptr(temp);
+void sc_hurst_bench(t_sc_hurst *x) {
+    if(x->series_length < 16) {
+        object_warn((t_object*)x, "Too few values to benchmark, requires 16 values, currently have %ld.", x->series_length);
+        return;
+    }
+    
+    t_atom line[7];
+    t_hurst_result exact;
+    t_hurst_result approx;
+    
+    //reference run over every block (reported with a budget of 0)
+    double t0 = systimer_gettime();
+    sc_hurst_compute(x, 0, 0, &exact);
+    double exact_ms = systimer_gettime() - t0;
+    
+    atom_setsym(line, gensym("bench"));
+    atom_setlong(line + 1, 0);
+    atom_setfloat(line + 2, exact.hurst);
+    atom_setfloat(line + 3, exact.error);
+    atom_setfloat(line + 4, 0);
+    atom_setfloat(line + 5, exact_ms);
+    atom_setlong(line + 6, exact.layer_count);
+    outlet_list(x->out, gensym("bench"), 7, line);
+    
+    //double the budget until it covers the finest layer: budget, estimate, standard error, deviation from reference, ms, layers.
+    //budget_us caps every run below, which is what bounds the latency of large windows
+    long finest_layer = x->series_length / sc_hurst_helper_div_size(x->series_length);
+    for(long budget = 2; budget < finest_layer; budget *= 2) {
+        t0 = systimer_gettime();
+        sc_hurst_compute(x, budget, x->budget_us / 1000, &approx);
+        double approx_ms = systimer_gettime() - t0;
+        
+        atom_setlong(line + 1, budget);
+        atom_setfloat(line + 2, approx.hurst);
+        atom_setfloat(line + 3, approx.error);
+        atom_setfloat(line + 4, fabs(approx.hurst - exact.hurst));
+        atom_setfloat(line + 5, approx_ms);
+        atom_setlong(line + 6, approx.layer_count);
+        outlet_list(x->out, gensym("bench"), 7, line);
+    }
+}
+
+void sc_hurst_shrink(t_sc_hurst *x) {
+    //the data set is about to move
+    sc_hurst_progress_stop(x);
+    
+    critical_enter(0);
+    long capacity = x->series_max_length + sc_hurst_slack(x->series_max_length);
+    if(x->data_capacity > capacity) {
+        sc_hurst_reserve(x, capacity);
+    }
+    if(x->deferred != NULL && x->deferred_length == 0) {
+        sysmem_freeptr(x->deferred);
+        x->deferred = NULL;
+        x->deferred_capacity = 0;
     }
+    critical_exit(0);
+}
+
+void sc_hurst_memory(t_sc_hurst *x) {
+    //data set, deferred values, history and sliding DFT, everything each instance allocates for itself
+    long reserved = (sizeof(double) * x->data_capacity) + 63;
+    long used = sizeof(double) * x->series_length;
+    
+    reserved += sizeof(double) * x->deferred_capacity;
+    used += sizeof(double) * x->deferred_length;
+    
+    if(x->pyramid != NULL) {
+        long queued = 0;
+        for(long i = 0; i < x->pyramid->filled_count; i++) {
+            queued += x->pyramid->filled_size[i];
+        }
+        reserved += sizeof(t_hurst_pyramid) + (sizeof(double) * (x->pyramid->staging_size + queued)) + ((sizeof(double*) + sizeof(long)) * x->pyramid->filled_capacity);
+        used += sizeof(t_hurst_pyramid) + (sizeof(double) * (x->pyramid->staging_length + queued));
+    }
+    
+    if(x->sdft != NULL) {
+        long bins = sizeof(t_hurst_sdft) + (sizeof(double) * 4 * x->sdft->bin_count);
+        reserved += bins;
+        used += bins;
+    }
+    
+    t_atom mem[3];
+    atom_setsym(mem, gensym("memory"));
+    atom_setlong(mem + 1, reserved);
+    atom_setlong(mem + 2, used);
+    outlet_list(x->out, gensym("memory"), 3, mem);
+}
+
+void sc_hurst_clear(t_sc_hurst *x){
+    sc_hurst_progress_stop(x);
+    
+    critical_enter(0);
+    x->deferred_length = 0;
     x->series_length = 0;
+    x->data_head = 0;
+    x->data_set = x->data_base;
+    if(x->pyramid != NULL) {
+        sc_hurst_pyramid_clear(x->pyramid);
+    }
+    x->history_generation++;
+    if(x->sdft != NULL) {
+        x->sdft->valid = 0;
+    }
     critical_exit(0);
 }
 
@@ -631,224 +1516,774 @@ void sc_hurst_calculate(t_sc_hurst *x) {
         return;
     }
     
-    //object_post((t_object*)x, "Beginning Calculations");
+    //the bank shares its blocks across horizons within one call, so it always runs right here
+    if(x->windows_count > 0) {
+        sc_hurst_bank_output(x);
+        return;
+    }
+    
+    if(x->progressive == 1) {
+        sc_hurst_progress_start(x); //output arrives slice by slice from the progress clock
+        return;
+    }
+    
+    if(x->batch == 1) {
+        sc_hurst_engine_request(x); //output arrives when the engine runs the next batch
+        return;
+    }
+    
+    t_hurst_result result;
+    sc_hurst_compute(x, (x->approx == 1) ? x->max_blocks_per_layer : 0, (x->approx == 1) ? x->budget_us / 1000 : 0, &result);
+    
+    sc_hurst_output(x, &result, x->approx);
+}
+
+void sc_hurst_output(t_sc_hurst *x, t_hurst_result* result, long show_error) {
+    //in approx mode the standard error goes out the dumpout before the estimate itself
+    if(show_error == 1) {
+        t_atom err[2];
+        atom_setsym(err, gensym("error"));
+        atom_setfloat(err + 1, result->error);
+        outlet_list(x->out, gensym("error"), 2, err);
+    }
+    
+    //generalized exponents go out ahead of the standard one
+    if(result->hq_count > 0) {
+        t_atom hq[SC_HURST_MAX_Q + 1];
+        atom_setsym(hq, gensym("hq"));
+        for(int i = 0; i < result->hq_count; i++) {
+            atom_setfloat(hq + i + 1, result->hq[i]);
+        }
+        outlet_list(x->out2, gensym("hq"), result->hq_count + 1, hq);
+    }
     
-    long div_size = 2;
+    //output the computed data
+    outlet_float(x->out2, result->hurst);
+}
+
+t_hurst_history* sc_hurst_history(t_sc_hurst *x) {
+    return (x->pyramid != NULL) ? &x->pyramid->history : NULL;
+}
+
+void sc_hurst_history_settle(t_sc_hurst *x) {
+    //a filled block costs as much as a calculation over the window, so it's evaluated outside the critical region
+    //and folded in under it afterwards, the same way sc_hurst_spectrum hands back its bins
+    critical_enter(0);
+    if(x->history_busy == 1) {
+        critical_exit(0);
+        return; //the thread already settling takes whatever was queued meanwhile too
+    }
+    x->history_busy = 1;
+    
+    long size = 0;
+    double* block;
+    while(x->pyramid != NULL && (block = sc_hurst_pyramid_take(x->pyramid, &size)) != NULL) {
+        long base_size = x->pyramid->history.base_size;
+        double horizon = x->pyramid->horizon;
+        long generation = x->history_generation;
+        critical_exit(0);
+        
+        t_hurst_staged staged;
+        sc_hurst_pyramid_evaluate(block, size, base_size, horizon, &staged);
+        
+        critical_enter(0);
+        //cleared or replaced meanwhile, the block belongs to a history that's gone
+        if(x->pyramid != NULL && x->history_generation == generation) {
+            sc_hurst_pyramid_apply(x->pyramid, &staged);
+        }
+    }
     
-    if(x->series_length < 64) {
-        div_size = 2;
-    } else if(x->series_length < 128) {
-        div_size = 4;
-    } else if(x->series_length < 256) {
-        div_size = 6;
+    x->history_busy = 0;
+    critical_exit(0);
+}
+
+long sc_hurst_estimator(t_sc_hurst *x) {
+    if(x->estimator == gensym("wavelet")) {
+        return SC_HURST_WAVELET;
+    } else if(x->estimator == gensym("spectral")) {
+        return SC_HURST_SPECTRAL;
+    }
+    return SC_HURST_RS;
+}
+
+void sc_hurst_bank_output(t_sc_hurst *x) {
+    double hurst[SC_HURST_MAX_WINDOWS];
+    long estimator = sc_hurst_estimator(x);
+    
+    long windows[SC_HURST_MAX_WINDOWS];
+    long windows_count;
+    
+    //only the newest values the longest horizon covers are copied, the calculation runs on the copy outside the critical region
+    critical_enter(0);
+    windows_count = x->windows_count;
+    long span = 0;
+    for(long w = 0; w < windows_count; w++) {
+        windows[w] = x->windows[w];
+        long len = (windows[w] < x->series_length) ? windows[w] : x->series_length;
+        span = (len > span) ? len : span;
+    }
+    double* snapshot = (double*)sysmem_newptr(sizeof(double) * ((span > 0) ? span : 1));
+    sysmem_copyptr(x->data_set + (x->series_length - span), snapshot, sizeof(double) * span);
+    critical_exit(0);
+    
+    if(estimator == SC_HURST_RS) {
+        sc_hurst_bank(snapshot, span, windows, windows_count, hurst);
     } else {
-        div_size = 8;
+        //the other estimators are O(n) or O(n log n) already, so each horizon gets its own pass over the newest values
+        for(long w = 0; w < windows_count; w++) {
+            long len = (windows[w] < span) ? windows[w] : span;
+            t_hurst_result result;
+            t_hurst_calc* calc = sc_hurst_calc_new(x, snapshot + (span - len), len, 0, NULL, 0, NULL, estimator);
+            sc_hurst_calc_step(calc, 0, NULL);
+            sc_hurst_calc_result(calc, &result);
+            sc_hurst_calc_free(calc);
+            hurst[w] = result.hurst;
+        }
     }
+    sysmem_freeptr(snapshot);
     
-    //object_post((t_object*)x, "Base division size: %ld", div_size);
+    //one exponent per horizon, in the order the windows were given
+    t_atom list[SC_HURST_MAX_WINDOWS];
+    for(long w = 0; w < windows_count; w++) {
+        atom_setfloat(list + w, hurst[w]);
+    }
+    outlet_list(x->out2, 0L, windows_count, list);
+}
+
+void sc_hurst_spectrum(t_sc_hurst *x, t_hurst_calc* calc) {
+    //sliding only makes sense once the window is full, before that the span keeps growing
+    if(calc->estimator != SC_HURST_SPECTRAL || x->series_length != x->series_max_length) {
+        return;
+    }
     
-    long layer_count = 0;
-    for(int i = 0; pow(2, i) * div_size <= x->series_length ; i++) {
-        //long test_val = pow(2, i) * div_size;
-        //object_post((t_object *)x, "Current step: %ld", test_val);
-        layer_count++;
+    critical_enter(0);
+    if(x->sdft == NULL || x->sdft->size != calc->div_size) {
+        if(x->sdft != NULL) {
+            sc_hurst_sdft_free(x->sdft);
+        }
+        x->sdft = sc_hurst_sdft_new(calc->div_size);
     }
+    if(x->sdft->valid == 1) {
+        sc_hurst_calc_set_spectrum(calc, x->sdft);
+        critical_exit(0);
+        return;
+    }
+    
+    //the FFT runs on a copy of the span so new values aren't held up behind it
+    long size = x->sdft->size;
+    double* span = (double*)sysmem_newptr(sizeof(double) * size);
+    sysmem_copyptr(x->data_set + (x->series_length - size), span, sizeof(double) * size);
+    critical_exit(0);
     
-   //object_post((t_object*)x, "Layer count: %ld", layer_count);
+    t_hurst_sdft* synced = sc_hurst_sdft_new(size);
+    sc_hurst_sdft_sync(synced, span);
+    sc_hurst_calc_set_spectrum(calc, synced);
+    
+    //the bins are only kept if the span still holds the samples they were taken from
+    critical_enter(0);
+    if(x->sdft != NULL && x->sdft->size == size && x->sdft->valid == 0 && x->series_length == x->series_max_length && x->series_length >= size) {
+        if(memcmp(x->data_set + (x->series_length - size), span, sizeof(double) * size) == 0) {
+            sc_hurst_sdft_free(x->sdft);
+            x->sdft = synced;
+            synced = NULL;
+        }
+    }
+    critical_exit(0);
     
-    double* rs_avg = (double*)sysmem_newptr(sizeof(double) * layer_count);
-    double* size = (double*)sysmem_newptr(sizeof(double) * layer_count);
+    if(synced != NULL) {
+        sc_hurst_sdft_free(synced);
+    }
+    sysmem_freeptr(span);
+}
+
+void sc_hurst_slide(t_sc_hurst *x, double value) {
+    if(x->sdft == NULL || x->sdft->valid == 0) {
+        return; //synced from scratch on the next calculation instead
+    }
     
-    double* rs_temp = rs_avg;
-    double* size_temp = size;
+    sc_hurst_sdft_slide(x->sdft, x->data_set[x->series_max_length - x->sdft->size], value);
     
-    for(int i = 0; i < layer_count; i++) {
-        long cur_div_size = pow(2, i) * div_size;
-        
-        long layer_size = x->series_length / cur_div_size;
-        
-        //object_post((t_object*)x, "Layer Block Count: %ld", layer_size);
-        //object_post((t_object*)x, "Layer Div Size: %ld", cur_div_size);
-        double rs_sum = 0;
-        for(int j = 0; j < layer_size; j++) {
-            //create and fill helper struct pointer
-            t_hurst_helper_ms* ms_temp = (t_hurst_helper_ms*)sysmem_newptr(sizeof(t_hurst_helper_ms));
-            ms_temp->src_data = x->data_set;
-            ms_temp->idx0 = (j * (pow(2, i) * div_size));
-            long end_idx = ((j + 1) * (pow(2, i) * div_size));
-            ms_temp->idx1 = (end_idx < x->series_length) ? end_idx : (x->series_length - 1);
-            ms_temp->mean = 0; //filled in function
-            ms_temp->stddev = 0; //filled in function
-            
-            sc_hurst_stddev_and_mean_helper(&ms_temp, x); //compute mean and standard deviation for the block.
-            
-            //copy out standard deviation and mean
-            double stddev = (ms_temp->stddev > 0) ? ms_temp->stddev : 0.0001;
-            double mean = ms_temp->mean;
-            //free the helper pointer after removing the reference to the struct data
-            ms_temp->src_data = NULL;
-            sysmem_freeptr(ms_temp);
+    //rounding error builds up with every rotation, so resync after a full span of slides
+    if(x->sdft->updates >= x->sdft->size) {
+        x->sdft->valid = 0;
+    }
+}
 
-#ifdef DEBUG
-            if(x->debug > 0) {
-                object_post((t_object*)x, "div size: %ld, block: %ld, mean: %f, stddev: %f", cur_div_size, j, mean, stddev);
-            }
-#endif
-            
-            t_hurst_helper_rs* rsa_temp = (t_hurst_helper_rs*)sysmem_newptr(sizeof(t_hurst_helper_rs));
-            rsa_temp->src_data = x->data_set;
-            rsa_temp->mean = mean;
-            rsa_temp->idx0 = (j * (pow(2, i) * div_size));
-            rsa_temp->idx1 = (end_idx < x->series_length) ? end_idx : (x->series_length - 1);
-            rsa_temp->range = 0;
-            
-            sc_hurst_helper_range(&rsa_temp);
-            double range = rsa_temp->range;
-            double rs = range / stddev;
-            rs_sum += rs;
-            
-#ifdef DEBUG
-            if(x->debug > 0) {
-                object_post((t_object*)x, "range: %f, rs: %f", range, rs);
-            }
-#endif
-            
-            //free the struct pointer
-            rsa_temp->src_data = NULL;
-            sysmem_freeptr(rsa_temp);
+void sc_hurst_compute(t_sc_hurst *x, long max_blocks, double budget_ms, t_hurst_result* result) {
+    t_hurst_calc* calc = sc_hurst_calc_new(x, x->data_set, x->series_length, max_blocks, x->qlist, x->qlist_count, sc_hurst_history(x), sc_hurst_estimator(x));
+    sc_hurst_spectrum(x, calc);
+    sc_hurst_calc_run(calc, budget_ms, systimer_gettime);
+    sc_hurst_calc_result(calc, result);
+    sc_hurst_calc_free(calc);
+}
+
+/*==================================================================================
+ ========================PROGRESSIVE CALCULATION=========================================
+ ====================================================================================*/
+
+void sc_hurst_progress_start(t_sc_hurst *x) {
+    //any calculation still running was made on data that has since changed
+    sc_hurst_progress_stop(x);
+    
+    //the calculation gets its own copy of the data set, so values arriving between slices can't move it
+    critical_enter(0);
+    double* snapshot = (double*)sysmem_newptr(sizeof(double) * x->series_length);
+    sysmem_copyptr(x->data_set, snapshot, sizeof(double) * x->series_length);
+    t_hurst_calc* calc = sc_hurst_calc_new(x, snapshot, x->series_length, (x->approx == 1) ? x->max_blocks_per_layer : 0, x->qlist, x->qlist_count, sc_hurst_history(x), sc_hurst_estimator(x));
+    critical_exit(0);
+    
+    sc_hurst_spectrum(x, calc);
+    
+    //another thread may have started one meanwhile, the newest wins
+    critical_enter(0);
+    sc_hurst_progress_discard(x);
+    x->prog_calc = calc;
+    critical_exit(0);
+    
+    //run the first slice right away so the coarse estimate is not delayed by a scheduler tick
+    sc_hurst_progress_tick(x);
+}
+
+void sc_hurst_progress_tick(t_sc_hurst *x) {
+    //the slice itself runs outside the critical region, the calculation is marked as being stepped instead
+    critical_enter(0);
+    t_hurst_calc* calc = x->prog_calc;
+    if(calc == NULL || x->prog_stepping != NULL) {
+        critical_exit(0);
+        return; //idle, or a tick on another thread is stepping it and reschedules when it's done
+    }
+    long generation = x->prog_generation;
+    x->prog_stepping = calc;
+    critical_exit(0);
+    
+    long layers_before = calc->layer;
+    long done = sc_hurst_calc_step(calc, systimer_gettime() + x->slice_ms, systimer_gettime);
+    
+    //a refined estimate goes out each time a slice completes a layer (a slope needs two of them)
+    long emit = (calc->layer > layers_before && calc->layer >= 2);
+    long layer = calc->layer;
+    long layer_count = calc->layer_count;
+    t_hurst_result result;
+    if(emit == 1) {
+        sc_hurst_calc_result(calc, &result);
+    }
+    
+    critical_enter(0);
+    x->prog_stepping = NULL;
+    if(x->prog_generation != generation) {
+        //stopped during the slice, whatever replaced it still needs its ticks
+        long pending = (x->prog_calc != NULL);
+        critical_exit(0);
+        sc_hurst_progress_release(calc);
+        if(pending == 1) {
+            clock_delay(x->prog_clock, 0);
+        }
+        return;
+    }
+    long flushed = 0;
+    if(done) {
+        x->prog_calc = NULL;
+        x->prog_generation++;
+        //data held back while calculating goes in ahead of anything that arrives from here on
+        if(x->deferred_length > 0) {
+            sc_hurst_progress_flush(x);
+            flushed = 1;
         }
+    }
+    critical_exit(0);
+    
+    if(done) {
+        sc_hurst_progress_release(calc);
+    } else {
+        clock_delay(x->prog_clock, 0); //pick up where we left off on the next scheduler tick
+    }
+    
+    if(emit == 1) {
+        t_atom prog[3];
+        atom_setsym(prog, gensym("progress"));
+        atom_setlong(prog + 1, layer);
+        atom_setlong(prog + 2, layer_count);
+        outlet_list(x->out, gensym("progress"), 3, prog);
         
-        *rs_temp = log2(rs_sum / ((layer_size > 0) ? layer_size : 1));
+        sc_hurst_output(x, &result, (done && x->approx == 1));
+    }
+    
+    //the flushed data may start the next calculation
+    if(flushed == 1) {
+        sc_hurst_history_settle(x);
+        if(x->calc_on_input == 1) {
+            sc_hurst_progress_start(x);
+        }
+    }
+}
 
-        *size_temp = log2((pow(2, i) * div_size));
+void sc_hurst_progress_stop(t_sc_hurst *x) {
+    clock_unset(x->prog_clock);
+    critical_enter(0);
+    sc_hurst_progress_discard(x);
+    critical_exit(0);
+}
 
-        
-#ifdef DEBUG
-        if(x->debug > 0) {
-            object_post((t_object*)x, "log2rs: %f, log2size: %f", *rs_temp, *size_temp);
+void sc_hurst_progress_discard(t_sc_hurst *x) {
+    if(x->prog_calc != NULL) {
+        if(x->prog_calc != x->prog_stepping) {
+            sc_hurst_progress_release(x->prog_calc);
         }
-#endif
-        rs_temp++;
-        size_temp++;
+        x->prog_calc = NULL;
+        x->prog_generation++;
+    }
+}
+
+void sc_hurst_progress_release(t_hurst_calc* calc) {
+    double* snapshot = calc->src_data;
+    sc_hurst_calc_free(calc);
+    sysmem_freeptr(snapshot);
+}
+
+long sc_hurst_progress_defer(t_sc_hurst *x, double* values, long count) {
+    critical_enter(0);
+    if(x->prog_calc == NULL || x->arrival_policy != gensym("defer")) {
+        critical_exit(0);
+        return 0;
     }
     
-    //create struct for linear regression helper function
-    t_hurst_helper_lin_reg* lr_temp = (t_hurst_helper_lin_reg*)sysmem_newptr(sizeof(t_hurst_helper_lin_reg));
-    lr_temp->rs = rs_avg;
-    lr_temp->size = size;
-    lr_temp->rs_length = layer_count;
-    lr_temp->size_length = layer_count;
-    lr_temp->slope = 0;
+    //only the newest series_max_length values can ever make it into the data set (nor the history, values dropped while waiting are lost to it)
+    if(count > x->series_max_length) {
+        values += count - x->series_max_length;
+        count = x->series_max_length;
+    }
     
-    sc_hurst_helper_linear_regression(&lr_temp);
+    if(x->deferred_capacity < x->series_max_length) {
+        double* temp = (double*)sysmem_newptr(sizeof(double) * x->series_max_length);
+        if(x->deferred != NULL) {
+            sysmem_copyptr(x->deferred, temp, sizeof(double) * x->deferred_length);
+            sysmem_freeptr(x->deferred);
+        }
+        x->deferred = temp;
+        x->deferred_capacity = x->series_max_length;
+    }
     
-    double hurst_exp = lr_temp->slope;
+    //drop the oldest deferred values once there is no room left
+    long overflow = x->deferred_length + count - x->series_max_length;
+    if(overflow > 0) {
+        sysmem_copyptr(x->deferred + overflow, x->deferred, sizeof(double) * (x->deferred_length - overflow));
+        x->deferred_length -= overflow;
+    }
     
-    //cleanup allocated memory
-    lr_temp->rs = NULL;
-    lr_temp->size = NULL;
-    sysmem_freeptr(lr_temp);
+    sysmem_copyptr(values, x->deferred + x->deferred_length, sizeof(double) * count);
+    x->deferred_length += count;
+    critical_exit(0);
     
-    for(int i = 0; i < layer_count; i++){
-        double* r2 = rs_avg;
-        double* s2 = size;
-        rs_avg++;
-        size++;
-        sysmem_freeptr(r2);
-        sysmem_freeptr(s2);
+    return 1;
+}
+
+void sc_hurst_progress_flush(t_sc_hurst *x) {
+    critical_enter(0);
+    long count = x->deferred_length;
+    double* values = x->deferred;
+    
+    //max_length may have shrunk since the values were deferred
+    if(count > x->series_max_length) {
+        values += count - x->series_max_length;
+        count = x->series_max_length;
     }
     
-    //output the computed data
-    outlet_float(x->out2, hurst_exp);
+    x->deferred_length = 0;
+    if(count > 0) {
+        sc_hurst_append(x, values, count);
+    }
+    critical_exit(0);
+}
+
+
+/*==================================================================================
+ ========================SHARED BATCH ENGINE=========================================
+ ====================================================================================*/
+
+void sc_hurst_engine_init(void) {
+    t_hurst_engine* e = &sc_hurst_engine;
+    
+    systhread_mutex_new(&e->lock, 0);
+    systhread_cond_new(&e->wake, 0);
+    systhread_cond_new(&e->done, 0);
+    e->clock = clock_new(e, (method)sc_hurst_engine_tick);
+    e->registered = 0;
+    e->pending = NULL;
+    e->pending_count = 0;
+    e->pending_capacity = 0;
+    e->jobs = NULL;
+    e->job_count = 0;
+    e->job_capacity = 0;
+    e->range_begin = NULL;
+    e->range_end = NULL;
+    e->remaining = 0;
+    e->generation = 0;
+    e->running = 0;
+    e->writing = NULL;
+    e->writer = NULL;
+    e->thread_count = sc_hurst_engine_cpu_count();
+    e->workers = NULL;
+    e->worker_index = NULL;
+    e->worker_count = 0;
+    e->quit = 0;
 }
 
+void sc_hurst_engine_register(t_sc_hurst *x) {
+    systhread_mutex_lock(sc_hurst_engine.lock);
+    sc_hurst_engine.registered++;
+    systhread_mutex_unlock(sc_hurst_engine.lock);
+}
 
-void sc_hurst_stddev_and_mean_helper(t_hurst_helper_ms** x, t_sc_hurst* t){
-    double* temp = (*x)->src_data + (*x)->idx0;
-    //for(int i = 0; i < (*x)->idx0; i++, temp++) {} //move to idx0
-    double* t2 = temp;
+void sc_hurst_engine_unregister(t_sc_hurst *x) {
+    t_hurst_engine* e = &sc_hurst_engine;
     
-    long length = (*x)->idx1 - (*x)->idx0;
+    systhread_mutex_lock(e->lock);
     
-    //calculate mean
-    double sum = 0;
-    for(int i = 0; i < length; i++, t2++) {
-        sum += *t2;
+    //drop any request that hasn't been picked up yet
+    for(long i = 0; i < e->pending_count; i++) {
+        if(e->pending[i] == x) {
+            e->pending[i] = e->pending[e->pending_count - 1];
+            e->pending_count--;
+            break;
+        }
     }
     
-#ifdef DEBUG
-    if(t->debug > 0) {
-        object_post((t_object*)t, "length: %ld, sum: %f", length, sum);
+    //the batch in flight must not write back to a freed instance
+    for(long i = 0; i < e->job_count; i++) {
+        if(e->jobs[i].owner == x) {
+            e->jobs[i].owner = NULL;
+        }
     }
-#endif
     
-    double mean = sum / ((double)length);
+    //a result already on its way out of x has to finish first, unless x is being freed from inside that output
+    while(e->writing == x && e->writer != systhread_self()) {
+        systhread_cond_wait(e->done, e->lock);
+    }
+    
+    e->registered--;
+    
+    //no instances left, so the threads and snapshots aren't needed until the next one asks for a batch.
+    //a tick in progress still uses both and tears them down itself when it's done
+    if(e->registered == 0 && e->running == 0) {
+        sc_hurst_engine_stop_workers(e);
+        sc_hurst_engine_free_jobs(e);
+    }
     
-    //calculate standard deviation
-    double stddev_sum = 0;
-    for(int i = 0; i < length; i++, temp++) {
-        stddev_sum += pow((*temp - mean), 2);
+    systhread_mutex_unlock(e->lock);
+}
+
+void sc_hurst_engine_request(t_sc_hurst *x) {
+    t_hurst_engine* e = &sc_hurst_engine;
+    
+    systhread_mutex_lock(e->lock);
+    
+    //repeated requests within a tick collapse into one calculation over the newest data
+    if(x->batch_pending == 0) {
+        if(e->pending_count == e->pending_capacity) {
+            long capacity = (e->pending_capacity > 0) ? e->pending_capacity * 2 : 64;
+            t_sc_hurst** temp = (t_sc_hurst**)sysmem_newptr(sizeof(t_sc_hurst*) * capacity);
+            if(e->pending != NULL) {
+                sysmem_copyptr(e->pending, temp, sizeof(t_sc_hurst*) * e->pending_count);
+                sysmem_freeptr(e->pending);
+            }
+            e->pending = temp;
+            e->pending_capacity = capacity;
+        }
+        e->pending[e->pending_count] = x;
+        e->pending_count++;
+        x->batch_pending = 1;
     }
     
-    double stddev = pow((stddev_sum * (1 / ((double)length))), 0.5);
+    systhread_mutex_unlock(e->lock);
     
-    (*x)->mean = mean;
-    (*x)->stddev = stddev;
+    clock_delay(e->clock, 0);
+}
+
+void sc_hurst_engine_tick(t_hurst_engine* e) {
+    systhread_mutex_lock(e->lock);
     
-#ifdef DEBUG
-    if(t->debug > 0) {
-        object_post((t_object*)t, "idx0: %ld, idx1: %ld, mean: %f, stddev: %f", (*x)->idx0, (*x)->idx1, mean, stddev);
+    if(e->pending_count == 0 || e->running == 1) {
+        systhread_mutex_unlock(e->lock);
+        return;
     }
-#endif
+    
+    //claimed before anything below can drop the lock, so unregister leaves the jobs and the pool alone
+    e->running = 1;
+    
+    //make room for this batch's jobs, keeping snapshot buffers from earlier batches
+    if(e->job_capacity < e->pending_count) {
+        t_hurst_job* temp = (t_hurst_job*)sysmem_newptr(sizeof(t_hurst_job) * e->pending_count);
+        for(long i = 0; i < e->pending_count; i++) {
+            temp[i].data = (i < e->job_capacity) ? e->jobs[i].data : NULL;
+            temp[i].capacity = (i < e->job_capacity) ? e->jobs[i].capacity : 0;
+        }
+        if(e->jobs != NULL) {
+            sysmem_freeptr(e->jobs);
+        }
+        e->jobs = temp;
+        e->job_capacity = e->pending_count;
+    }
+    
+    //snapshot every pending instance's data so input arriving mid-batch can't change it under the workers
+    e->job_count = 0;
+    critical_enter(0);
+    for(long i = 0; i < e->pending_count; i++) {
+        t_sc_hurst* x = e->pending[i];
+        x->batch_pending = 0;
+        
+        if(x->series_length < 16) {
+            continue; //cleared since the request
+        }
+        
+        t_hurst_job* job = e->jobs + e->job_count;
+        if(job->capacity < x->series_length) {
+            if(job->data != NULL) {
+                sysmem_freeptr(job->data);
+            }
+            job->data = (double*)sysmem_newptr(sizeof(double) * x->series_max_length);
+            job->capacity = x->series_max_length;
+        }
+        sysmem_copyptr(x->data_set, job->data, sizeof(double) * x->series_length);
+        job->owner = x;
+        job->length = x->series_length;
+        job->approx = x->approx;
+        job->max_blocks = (x->approx == 1) ? x->max_blocks_per_layer : 0;
+        job->budget_ms = (x->approx == 1) ? x->budget_us / 1000 : 0;
+        job->qlist_count = x->qlist_count;
+        for(long q = 0; q < x->qlist_count; q++) {
+            job->qlist[q] = x->qlist[q];
+        }
+        job->estimator = sc_hurst_estimator(x);
+        job->has_history = (x->pyramid != NULL);
+        if(x->pyramid != NULL) {
+            job->history = x->pyramid->history;
+        }
+        e->job_count++;
+    }
+    critical_exit(0);
+    e->pending_count = 0;
+    
+    //resize the pool here, the only place where no batch can be in flight
+    if(e->range_begin == NULL || e->worker_count != e->thread_count - 1) {
+        sc_hurst_engine_stop_workers(e);
+        sc_hurst_engine_start_workers(e);
+    }
+    
+    //hand each participant an even share of the jobs, anyone who runs out steals from the back of another's share
+    long participants = e->worker_count + 1;
+    for(long i = 0; i < participants; i++) {
+        e->range_begin[i] = (e->job_count * i) / participants;
+        e->range_end[i] = (e->job_count * (i + 1)) / participants;
+    }
+    e->remaining = e->job_count;
+    e->generation++;
+    systhread_cond_broadcast(e->wake);
+    systhread_mutex_unlock(e->lock);
+    
+    //the scheduler thread works through the batch alongside the pool
+    sc_hurst_engine_work(e, 0);
+    
+    systhread_mutex_lock(e->lock);
+    while(e->remaining > 0) {
+        systhread_cond_wait(e->done, e->lock);
+    }
+    long job_count = e->job_count;
+    
+    //write each result back out of its owner's outlets. The owner is read and marked under the lock, so an
+    //instance freed on another thread either is skipped or waits until its output is done
+    e->writer = systhread_self();
+    for(long i = 0; i < job_count; i++) {
+        t_hurst_job* job = e->jobs + i;
+        t_sc_hurst* x = job->owner;
+        if(x == NULL) {
+            continue;
+        }
+        
+        e->writing = x;
+        systhread_mutex_unlock(e->lock);
+        sc_hurst_output(x, &job->result, job->approx);
+        systhread_mutex_lock(e->lock);
+        e->writing = NULL;
+        systhread_cond_broadcast(e->done);
+    }
+    e->writer = NULL;
+    
+    e->job_count = 0;
+    e->running = 0;
+    if(e->registered == 0) {
+        //the last instance went away during the batch
+        sc_hurst_engine_stop_workers(e);
+        sc_hurst_engine_free_jobs(e);
+    }
+    systhread_mutex_unlock(e->lock);
 }
 
-void sc_hurst_helper_range(t_hurst_helper_rs** x) {
-    double* temp = (*x)->src_data + (*x)->idx0;
-    //for(int i = 0; i < (*x)->idx0; i++, temp++){} //move to the starting index
-    long length = (*x)->idx1 - (*x)->idx0;
+void sc_hurst_engine_work(t_hurst_engine* e, long participant) {
+    long participants = e->worker_count + 1;
     
-    double min = *temp - (*x)->mean;
-    double max = *temp - (*x)->mean;
+    while(1) {
+        long job_idx = -1;
+        
+        systhread_mutex_lock(e->lock);
+        if(e->range_begin[participant] < e->range_end[participant]) {
+            job_idx = e->range_begin[participant];
+            e->range_begin[participant]++;
+        } else {
+            //steal from the back of the next participant that still has jobs
+            for(long i = 1; i < participants; i++) {
+                long victim = (participant + i) % participants;
+                if(e->range_begin[victim] < e->range_end[victim]) {
+                    e->range_end[victim]--;
+                    job_idx = e->range_end[victim];
+                    break;
+                }
+            }
+        }
+        systhread_mutex_unlock(e->lock);
+        
+        if(job_idx < 0) {
+            return;
+        }
+        
+        t_hurst_job* job = e->jobs + job_idx;
+        t_hurst_calc* calc = sc_hurst_calc_new(job->owner, job->data, job->length, job->max_blocks, job->qlist, job->qlist_count, (job->has_history == 1) ? &job->history : NULL, job->estimator);
+        sc_hurst_calc_run(calc, job->budget_ms, systimer_gettime);
+        sc_hurst_calc_result(calc, &job->result);
+        sc_hurst_calc_free(calc);
+        
+        systhread_mutex_lock(e->lock);
+        e->remaining--;
+        if(e->remaining == 0) {
+            systhread_cond_signal(e->done);
+        }
+        systhread_mutex_unlock(e->lock);
+    }
+}
+
+void* sc_hurst_engine_worker(long* participant) {
+    t_hurst_engine* e = &sc_hurst_engine;
+    long generation = 0;
     
-    double t = 0;
-    for(int i = 0; i < length; i++, temp++) {
-        t += (*temp - (*x)->mean); //t'(n) = (t(n) - mean) + t'(n-1)
-        if(t > max) {
-            max = t;
-        } else if(t < min) {
-            min = t;
+    systhread_mutex_lock(e->lock);
+    while(e->quit == 0) {
+        generation = e->generation;
+        
+        //take whatever is left of the current batch, a worker started by a tick joins that tick's batch here
+        systhread_mutex_unlock(e->lock);
+        sc_hurst_engine_work(e, *participant);
+        systhread_mutex_lock(e->lock);
+        
+        while(e->quit == 0 && e->generation == generation) {
+            systhread_cond_wait(e->wake, e->lock);
         }
     }
-    (*x)->range = max - min;
+    systhread_mutex_unlock(e->lock);
+    
+    systhread_exit(0);
+    return NULL;
 }
 
-void sc_hurst_helper_linear_regression(t_hurst_helper_lin_reg** x){
-    double* s = (*x)->size; //x-axis values
-    double* r = (*x)->rs; //y-axis values
-    double length = (*x)->rs_length;
-    double sumx = 0;
-    double sumy = 0;
-    double sumxsq = 0;
-    double sumxy = 0;
+void sc_hurst_engine_start_workers(t_hurst_engine* e) {
+    //called with the lock held, the workers block on it until the caller waits or unlocks
+    long worker_count = (e->thread_count > 1) ? e->thread_count - 1 : 0;
+    
+    e->range_begin = (long*)sysmem_newptr(sizeof(long) * (worker_count + 1));
+    e->range_end = (long*)sysmem_newptr(sizeof(long) * (worker_count + 1));
+    e->worker_index = (long*)sysmem_newptr(sizeof(long) * (worker_count + 1));
+    if(worker_count > 0) {
+        e->workers = (t_systhread*)sysmem_newptr(sizeof(t_systhread) * worker_count);
+    }
+    e->quit = 0;
     
-    for(int i = 0; i < length; i++, s++, r++){
-        sumx += *s;
-        sumy += *r;
-        sumxsq += pow(*s, 2);
-        sumxy += *s * *r;
+    for(long i = 0; i <= worker_count; i++) {
+        e->range_begin[i] = 0;
+        e->range_end[i] = 0;
     }
     
-    double denom = (length * sumxsq) - pow(sumx, 2);
-    double slope = ((length * sumxy) - (sumx * sumy)) / denom;
+    for(long i = 0; i < worker_count; i++) {
+        e->worker_index[i] = i + 1; //participant 0 is the scheduler thread
+        systhread_create((method)sc_hurst_engine_worker, e->worker_index + i, 0, 0, 0, e->workers + i);
+    }
+    e->worker_count = worker_count;
+}
+
+void sc_hurst_engine_stop_workers(t_hurst_engine* e) {
+    //called with the lock held, which is released while joining so the workers can see quit
+    unsigned int ret;
+    
+    e->quit = 1;
+    systhread_cond_broadcast(e->wake);
+    systhread_mutex_unlock(e->lock);
+    for(long i = 0; i < e->worker_count; i++) {
+        systhread_join(e->workers[i], &ret);
+    }
+    systhread_mutex_lock(e->lock);
     
-    (*x)->slope = slope;
+    if(e->workers != NULL) {
+        sysmem_freeptr(e->workers);
+        e->workers = NULL;
+    }
+    if(e->range_begin != NULL) {
+        sysmem_freeptr(e->range_begin);
+        sysmem_freeptr(e->range_end);
+        sysmem_freeptr(e->worker_index);
+        e->range_begin = NULL;
+        e->range_end = NULL;
+        e->worker_index = NULL;
+    }
+    e->worker_count = 0;
 }
 
+long sc_hurst_engine_cpu_count(void) {
+    long count = 1;
+#ifdef WIN_VERSION
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (long)info.dwNumberOfProcessors;
+#else
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    //same limits as the thread_count attribute
+    if(count < 1) {
+        return 1;
+    }
+    return (count > 64) ? 64 : count;
+}
+
+void sc_hurst_engine_free_jobs(t_hurst_engine* e) {
+    for(long i = 0; i < e->job_capacity; i++) {
+        if(e->jobs[i].data != NULL) {
+            sysmem_freeptr(e->jobs[i].data);
+        }
+    }
+    if(e->jobs != NULL) {
+        sysmem_freeptr(e->jobs);
+    }
+    e->jobs = NULL;
+    e->job_count = 0;
+    e->job_capacity = 0;
+}
+
+
 /*================================================================
  =========================DEBUGGING ATTRIBUTE=====================
  =================================================================*/
 
 #ifdef DEBUG
+void sc_hurst_debug_post(void* owner, const char* fmt, ...) {
+    t_sc_hurst* x = (t_sc_hurst*)owner;
+    if(x == NULL || x->debug == 0) {
+        return;
+    }
+    
+    char msg[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    object_post((t_object*)x, "%s", msg);
+}
+
 void sc_hurst_set_debug(t_sc_hurst *x, void *attr, long argc, t_atom *argv){
     if(argc && argv) {
         long temp_d = atom_getlong(argv);